@@ -5,27 +5,30 @@
 #include <string.h>
 #include <tgmath.h>
 
+#include "lib/input.h"
+#include "lib/parseint.h"
+
+// Depths parsed per call to parselongs().
+#define BATCH 4096
+
 int main(void) {
   int larger = 0;
 
   int prev = INT32_MIN;
-  char *line = NULL;
-  size_t len = 0;
-  ssize_t read;
-  while ((read = getline(&line, &len, stdin)) != -1) {
-    int curr = atoi(line);
-    if (prev < curr) {
-      larger++;
-    }
-    prev = curr;
-  }
-  free(line);
-  if (read == -1) {
-    if (!feof(stdin)) {
-      perror("getline");
-      exit(EXIT_FAILURE);
+  Input *in = xopeninput(NULL);
+  char const *p = in->buf, *end = in->buf + in->len;
+  long depths[BATCH];
+  size_t n;
+  while ((n = parselongs(&p, end, depths, BATCH))) {
+    for (size_t i = 0; i < n; i++) {
+      int curr = depths[i];
+      if (prev < curr) {
+        larger++;
+      }
+      prev = curr;
     }
   }
+  closeinput(in);
   larger--;
   if (larger < 0) {
     larger = 0;
@@ -4,6 +4,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+
+#include "lib/input.h"
+#include "lib/parseint.h"
+#include "lib/stream.h"
 
 #ifndef NDEBUG
 #define dbgprintf(args...) fprintf(stderr, args)
@@ -11,47 +16,62 @@
 #define dbgprintf(args...)
 #endif
 
+// Depths parsed per call to parselongs().
+#define BATCH 4096
+
 int main(void) {
   int larger = 0;
 
   int prev = INT32_MIN;
   int x = INT32_MIN, y = INT32_MIN, z = INT32_MIN;
-  char *line = NULL;
-  size_t len = 0;
-  ssize_t read;
-  while ((read = getline(&line, &len, stdin)) != -1) {
-    if (x == INT32_MIN) {
-      x = atoi(line);
-    } else if (y == INT32_MIN) {
-      y = atoi(line);
-    } else if (z == INT32_MIN) {
-      z = atoi(line);
-      int cur = atoi(line) + x + y;
-      if (cur > prev) {
-        larger++;
-      }
-      prev = cur;
-    } else {
-      int w = atoi(line);
-      dbgprintf("... w = %d\n", w);
-      x = y;
-      y = z;
-      z = w;
-      int sum = x + y + z;
-      if (prev < sum) {
-        dbgprintf("x = %d, y = %d, z = %d, sum = %d\n", x, y, z, sum);
-        larger++;
+  Stream *in = xopenstream(STDIN_FILENO, STREAMBLOCK);
+  Input block;
+  long depths[BATCH];
+  size_t n;
+  // The last byte of the block before, since a blank line can be split
+  // between two blocks.
+  char last = 0;
+  while (nextblock(in, &block)) {
+    char const *p = block.buf, *end = block.buf + block.len;
+    if (last == '\n' && p < end && *p == '\n') {
+      // A blank line ends the input.
+      break;
+    }
+    while ((n = parselongs(&p, end, depths, BATCH))) {
+      for (size_t i = 0; i < n; i++) {
+        if (x == INT32_MIN) {
+          x = depths[i];
+        } else if (y == INT32_MIN) {
+          y = depths[i];
+        } else if (z == INT32_MIN) {
+          z = depths[i];
+          int cur = z + x + y;
+          if (cur > prev) {
+            larger++;
+          }
+          prev = cur;
+        } else {
+          int w = depths[i];
+          dbgprintf("... w = %d\n", w);
+          x = y;
+          y = z;
+          z = w;
+          int sum = x + y + z;
+          if (prev < sum) {
+            dbgprintf("x = %d, y = %d, z = %d, sum = %d\n", x, y, z, sum);
+            larger++;
+          }
+          prev = sum;
+        }
       }
-      prev = sum;
     }
-  }
-  free(line);
-  if (read == -1) {
-    if (!feof(stdin)) {
-      perror("getline");
-      exit(EXIT_FAILURE);
+    if (p < end) {
+      // A blank line ends the input.
+      break;
     }
+    last = block.len ? end[-1] : last;
   }
+  closestream(in);
   larger--;
   if (larger < 0) {
     larger = 0;
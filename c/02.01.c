@@ -3,6 +3,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "lib/input.h"
+#include "lib/parseint.h"
+
 #define FORWARDS "forward"
 #define FORWARDL sizeof(FORWARDS)
 #define UPS "up"
@@ -10,39 +13,37 @@
 #define DOWNS "down"
 #define DOWNL sizeof(DOWNS)
 
+// The number after the command word (and its space) on a line.
+static int argument(StrView s, size_t skip) {
+  StrView arg = svskip(s, skip);
+  return parselong(&arg.p, arg.p + arg.len);
+}
+
 int main(void) {
   int x = 0, y = 0;
-  char *s = NULL;
-  size_t len = 0;
-  ssize_t read;
+  Input *in = xopeninput(NULL);
+  StrView s;
 
-  while ((read = getline(&s, &len, stdin)) != -1) {
-    // Really here for debugging string compares
-    int cmp;
-    if ((cmp = strncmp(s, FORWARDS, FORWARDL - 1)) == 0) {
-      int dx = atoi(s + FORWARDL);
+  while (nextline(in, &s)) {
+    if (svprefix(s, FORWARDS)) {
+      int dx = argument(s, FORWARDL);
       x += dx;
-    } else if ((cmp = strncmp(s, UPS, UPL - 1)) == 0) {
-      int dy = atoi(s + UPL);
+    } else if (svprefix(s, UPS)) {
+      int dy = argument(s, UPL);
       // "up" DECREASES y
       y -= dy;
-    } else if (read == 1) {
+    } else if (s.len == 0) {
       // Empty line
       break;
     } else {
-      assert((cmp = strncmp(s, DOWNS, DOWNL - 1)) == 0);
-      int dy = atoi(s + DOWNL);
+      assert(svprefix(s, DOWNS));
+      int dy = argument(s, DOWNL);
       // "down" INCREASES y
       y += dy;
     }
   }
 
-  if (read == -1) {
-    if (!feof(stdin)) {
-      perror("getline");
-      exit(EXIT_FAILURE);
-    }
-  }
+  closeinput(in);
 
   printf("distance (%d) * depth (%d) = %ld\n", x, y, (long)x * y);
   return 0;
@@ -1,11 +1,19 @@
 #include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+
+#include "lib/input.h"
+#include "lib/parseint.h"
+#include "lib/stream.h"
+#include "lib/xalloc.h"
 
 #ifndef NDEBUG
 #define dbgprintf(args...) fprintf(stderr, args)
-#define dbgvalp() dbgprintf("x = %d, y = %d, r = %d\n", x, y, r)
+#define dbgvalp() dbgprintf("x = %ld, y = %ld, r = %ld\n", t.x, t.y, t.r)
 #else
 #define dbgprintf(args...)
 #define dbgvalp()
@@ -18,44 +26,139 @@
 #define DOWNS "down"
 #define DOWNL sizeof(DOWNS)
 
-int main(void) {
-  int x = 0, y = 0, r = 0;
-  char *s = NULL;
-  size_t len = 0;
-  ssize_t read;
-
-  while ((read = getline(&s, &len, stdin)) != -1) {
-    // Really here for debugging string compares
-    int cmp;
-    if ((cmp = strncmp(s, FORWARDS, FORWARDL - 1)) == 0) {
-      int dx = atoi(s + FORWARDL);
-      x += dx;
-      y += dx * r;
+// The effect of a run of commands on the state (x, y, r), which is itself
+// affine: x and r move by x and r, and y by y plus x times the aim (r) that
+// the run starts with. Applied to the initial state (0, 0, 0), it IS the final
+// state.
+typedef struct {
+  long x, y, r;
+} Affine;
+
+// The run (a) followed by the run (b). This is associative, so runs can be
+// folded separately and combined in order afterwards.
+static Affine composeaffine(Affine a, Affine b) {
+  return (Affine){.x = a.x + b.x, .y = a.y + b.y + b.x * a.r, .r = a.r + b.r};
+}
+
+// The number after the command word (and its space) on a line.
+static int argument(StrView s, size_t skip) {
+  StrView arg = svskip(s, skip);
+  return parselong(&arg.p, arg.p + arg.len);
+}
+
+// Fold the commands of (in) into (*out). Return false if an empty line ended
+// the input.
+static bool foldcommands(Input *in, Affine *out) {
+  Affine t = {0};
+  StrView s;
+  bool more = true;
+  while (nextline(in, &s)) {
+    if (svprefix(s, FORWARDS)) {
+      int dx = argument(s, FORWARDL);
+      t.x += dx;
+      t.y += dx * t.r;
       dbgvalp();
-    } else if ((cmp = strncmp(s, UPS, UPL - 1)) == 0) {
-      int dr = atoi(s + UPL);
+    } else if (svprefix(s, UPS)) {
+      int dr = argument(s, UPL);
       // "up" DECREASES r
-      r -= dr;
+      t.r -= dr;
       dbgvalp();
-    } else if (read == 1) {
+    } else if (s.len == 0) {
       // Empty line
+      more = false;
       break;
     } else {
-      assert((cmp = strncmp(s, DOWNS, DOWNL - 1)) == 0);
-      int dr = atoi(s + DOWNL);
+      assert(svprefix(s, DOWNS));
+      int dr = argument(s, DOWNL);
       // "down" INCREASES r
-      r += dr;
+      t.r += dr;
       dbgvalp();
     }
   }
+  *out = t;
+  return more;
+}
+
+// Read stdin block by block on one core, in constant memory.
+static Affine foldstream(void) {
+  Affine t = {0}, u;
+  Stream *in = xopenstream(STDIN_FILENO, STREAMBLOCK);
+  Input block;
+  while (nextblock(in, &block)) {
+    bool more = foldcommands(&block, &u);
+    t = composeaffine(t, u);
+    if (!more) {
+      break;
+    }
+  }
+  closestream(in);
+  return t;
+}
+
+typedef struct {
+  Input chunk;
+  Affine t;
+  bool more;
+} Job;
+
+static void *runjob(void *arg) {
+  Job *job = arg;
+  job->more = foldcommands(&job->chunk, &job->t);
+  return NULL;
+}
+
+// Load stdin whole, cut it at newlines into (nthreads) chunks, fold each
+// chunk on its own thread, then combine the chunks in order.
+static Affine foldparallel(int nthreads) {
+  Input *in = xopeninput(NULL);
+  Job *jobs = xcalloc(nthreads, sizeof(Job));
+  pthread_t *threads = xcalloc(nthreads, sizeof(pthread_t));
+  size_t start = 0;
+  for (int i = 0; i < nthreads; i++) {
+    size_t stop = i == nthreads - 1 ? in->len : in->len / nthreads * (i + 1);
+    stop = stop < start ? start : stop;
+    while (stop > 0 && stop < in->len && in->buf[stop - 1] != '\n') {
+      stop++;
+    }
+    jobs[i].chunk = (Input){.buf = in->buf + start, .len = stop - start};
+    start = stop;
+    int err = pthread_create(&threads[i], NULL, runjob, &jobs[i]);
+    if (err) {
+      fprintf(stderr, "pthread_create: %s\n", strerror(err));
+      abort();
+    }
+  }
+
+  Affine t = {0};
+  bool more = true;
+  for (int i = 0; i < nthreads; i++) {
+    pthread_join(threads[i], NULL);
+    // Whatever follows an empty line is not part of the input.
+    if (more) {
+      t = composeaffine(t, jobs[i].t);
+      more = jobs[i].more;
+    }
+  }
+  free(threads);
+  free(jobs);
+  closeinput(in);
+  return t;
+}
 
-  if (read == -1) {
-    if (!feof(stdin)) {
-      perror("getline");
-      exit(EXIT_FAILURE);
+// With an argument, fold the commands on that many threads (0: one per
+// online CPU); otherwise stream them on one.
+int main(int argc, char *argv[]) {
+  Affine t;
+  if (argc == 2) {
+    long nthreads = atol(argv[1]);
+    if (nthreads <= 0) {
+      nthreads = sysconf(_SC_NPROCESSORS_ONLN);
     }
+    t = foldparallel(nthreads > 0 ? nthreads : 1);
+  } else {
+    t = foldstream();
   }
 
-  printf("distance (%d) * depth (%d) = %ld\n", x, y, (long)x * y);
+  printf("distance (%ld) * depth (%ld) = %ld\n", t.x, t.y, t.x * t.y);
   return 0;
-}
\ No newline at end of file
+}
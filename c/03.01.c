@@ -1,8 +1,12 @@
-#include <assert.h>
 #include <inttypes.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+
+#include "lib/input.h"
+#include "lib/stream.h"
 
 #ifndef NDEBUG
 #define dbgprintf(args...) fprintf(stderr, args)
@@ -17,38 +21,44 @@
 int main(void) {
   int *n0 = calloc(NBITS, sizeof(int));
   int *n1 = calloc(NBITS, sizeof(int));
-  char *s = NULL;
-  size_t r = 0;
-  ssize_t n;
-  int dbg_isfirst = 1;
-
-  while ((n = getline(&s, &r, stdin)) != -1) {
-    if (dbg_isfirst) {
-      assert(strlen(s) == NBITS + 1);
-      dbg_isfirst = 0;
-    }
+  Stream *in = xopenstream(STDIN_FILENO, STREAMBLOCK);
+  Input block;
+  StrView s;
+  bool parsed = true;
 
-    if (n == 1) {
-      // Empty line
-      break;
-    }
+  while (nextblock(in, &block)) {
+    while (nextline(&block, &s)) {
+      if (s.len == 0) {
+        // Empty line
+        goto end_input;
+      }
 
-    for (int i = 0; i < NBITS; i++) {
-      int k = NBITS - 1 - i;
-      if (s[i] == '1') {
-        n1[k]++;
-      } else {
-        assert(s[i] == '0');
-        n0[k]++;
+      size_t bits = 0;
+      while (bits < s.len && (s.p[bits] == '0' || s.p[bits] == '1')) {
+        bits++;
+      }
+      if (bits != NBITS || s.len != NBITS) {
+        fprintf(stderr, "Parse failure. \"%.*s\" is not %d bits\n",
+                PRIsv(s), NBITS);
+        parsed = false;
+        goto end_input;
+      }
+      for (int i = 0; i < NBITS; i++) {
+        int k = NBITS - 1 - i;
+        if (s.p[i] == '1') {
+          n1[k]++;
+        } else {
+          n0[k]++;
+        }
       }
     }
   }
-  free(s);
-  if (n == -1) {
-    if (!feof(stdin)) {
-      perror("getline");
-      exit(1);
-    }
+end_input:
+  closestream(in);
+  if (!parsed) {
+    free(n1);
+    free(n0);
+    return 1;
   }
 
   int eps = 0, gam = 0;
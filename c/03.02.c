@@ -1,10 +1,14 @@
 #include <assert.h>
-#include <errno.h>
+#include <fcntl.h>
 #include <inttypes.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+
+#include "lib/input.h"
+#include "lib/stream.h"
 
 #ifndef NDEBUG
 #define dbgprintf(args...) fprintf(stderr, ##args)
@@ -12,46 +16,32 @@
 #define dbgprintf(args...)
 #endif
 
-#define perrorf(pattern, args...)                                              \
-  fprintf(stderr, pattern ": %s\n", ##args, strerror(errno))
-
 // Program parameters
 // (Change if you get a different input file)
 #define NBITS 12
 
+// How many times each NBITS-bit value occurs. Its size depends only on
+// NBITS, not on the length of the input.
 typedef struct {
-  uint64_t *data;
-  ssize_t len;
-  ssize_t cap;
-} IntVec;
-
-static IntVec *mkintvec(void) {
-  IntVec *v = calloc(1, sizeof(IntVec));
-  v->data = calloc(1, sizeof(uint64_t));
-  v->len = 0;
-  v->cap = 1;
-  return v;
+  long *count;
+  long total;
+} Histogram;
+
+static Histogram *mkhist(void) {
+  Histogram *h = calloc(1, sizeof(Histogram));
+  h->count = calloc((size_t)1 << NBITS, sizeof(long));
+  return h;
 }
 
-static void freeintvec(IntVec *v) {
-  free(v->data);
-  free(v);
+static void freehist(Histogram *h) {
+  free(h->count);
+  free(h);
 }
 
-static void insintvec(IntVec *v, uint64_t i) {
-  if (v->len == v->cap) {
-    v->cap *= 2;
-    v->data = realloc(v->data, v->cap * sizeof(uint64_t));
-    if (!v->data) {
-      fprintf(stderr, "insintvec: realloc");
-      exit(1);
-    }
-  }
-  v->data[v->len++] = i;
-}
-
-static void compactvec(IntVec *v) {
-  v->data = realloc(v->data, v->len * sizeof(uint64_t));
+static void inshist(Histogram *h, uint64_t i) {
+  assert(i < ((uint64_t)1 << NBITS));
+  h->count[i]++;
+  h->total++;
 }
 
 typedef struct {
@@ -72,9 +62,13 @@ static void freebstats(BitStats *bs) {
   free(bs);
 }
 
-static void mark1(BitStats *bs, int bit_pos) { bs->n1[bit_pos]++; }
+static void mark1(BitStats *bs, int bit_pos, long times) {
+  bs->n1[bit_pos] += times;
+}
 
-static void mark0(BitStats *bs, int bit_pos) { bs->n0[bit_pos]++; }
+static void mark0(BitStats *bs, int bit_pos, long times) {
+  bs->n0[bit_pos] += times;
+}
 
 static int maxat(BitStats *bs, int bit_pos, int prefer) {
   assert(prefer == 0 || prefer == 1);
@@ -101,47 +95,46 @@ static int minat(BitStats *bs, int bit_pos, int prefer) {
 #define BIT(n, p) (((n) & (1 << (p))) ? 1 : 0)
 
 int main(int argc, char *argv[]) {
-  FILE *file = NULL;
   if (argc != 2 || argv[1] == NULL) {
     fprintf(stderr, "Usage: %s <input file>\n", argv[0]);
     return 1;
   }
-  if ((file = fopen(argv[1], "r")) == NULL) {
-    perrorf("Opening file \"%s\"", argv[1]);
-    return 1;
+  int fd = STDIN_FILENO;
+  if (strcmp(argv[1], "-") != 0) {
+    fd = open(argv[1], O_RDONLY);
+    if (fd < 0) {
+      perror(argv[1]);
+      return 1;
+    }
   }
-  IntVec *numbers = mkintvec();
+  Stream *file = xopenstream(fd, STREAMBLOCK);
+  Input block;
+  Histogram *numbers = mkhist();
   BitStats *bit_stats = mkbstats();
 
-  char *s = NULL;
-  size_t ns = 0;
-  ssize_t read;
-  while ((read = getline(&s, &ns, file)) > 0) {
-    if (read == 1) {
-      // Empty line
-      break;
-    }
-    long lx = strtol(s, NULL, 2);
-    dbgprintf("Number %lu for string %s", lx, s);
-    insintvec(numbers, (uint64_t)lx);
-  }
-  free(s);
-  if (read == -1) {
-    if (!feof(file)) {
-      perror("Reading file");
-      exit(1);
+  StrView s;
+  while (nextblock(file, &block)) {
+    while (nextline(&block, &s)) {
+      if (s.len == 0) {
+        // Empty line
+        goto end_input;
+      }
+      long lx = svtol(s, 2, NULL);
+      dbgprintf("Number %lu for string %.*s\n", lx, PRIsv(s));
+      inshist(numbers, (uint64_t)lx);
     }
   }
-  compactvec(numbers);
+end_input:
+  closestream(file);
 
-  for (int i = 0; i < numbers->len; i++) {
-    uint64_t n = numbers->data[i];
+  for (uint64_t n = 0; n < ((uint64_t)1 << NBITS); n++) {
+    long c = numbers->count[n];
     for (int j = 0; j < NBITS; j++) {
       uint64_t b = BIT(n, j);
       if (b) {
-        mark1(bit_stats, j);
+        mark1(bit_stats, j, c);
       } else {
-        mark0(bit_stats, j);
+        mark0(bit_stats, j, c);
       }
     }
   }
@@ -166,23 +159,25 @@ int main(int argc, char *argv[]) {
   // leaves only one digit to be traveled, then return
   // (the first) of them.
 
-  // 1 if traversable; 0 if not.
-  int *oxy_traversable = malloc(sizeof(int) * numbers->len);
-  int *co2_traversable = malloc(sizeof(int) * numbers->len);
-  memset(oxy_traversable, true, sizeof(int) * numbers->len);
-  memset(co2_traversable, true, sizeof(int) * numbers->len);
+  // 1 if traversable; 0 if not. Indexed by value, like the histogram.
+  int nvalues = 1 << NBITS;
+  int *oxy_traversable = malloc(sizeof(int) * nvalues);
+  int *co2_traversable = malloc(sizeof(int) * nvalues);
+  memset(oxy_traversable, true, sizeof(int) * nvalues);
+  memset(co2_traversable, true, sizeof(int) * nvalues);
   int last_oxy_traversed = -1;
   int last_co2_traversed = -1;
   int n_oxy_traversed = 0;
   int n_co2_traversed = 0;
   for (int d = 0; d < NBITS; d++) {
     n_oxy_traversed = 0;
-    for (int i = 0; i < numbers->len; i++) {
+    for (int i = 0; i < nvalues; i++) {
     }
   }
 
+  free(co2_traversable);
+  free(oxy_traversable);
   freebstats(bit_stats);
-  freeintvec(numbers);
-  fclose(file);
+  freehist(numbers);
   return 0;
 }
@@ -1,14 +1,16 @@
 // Add up the 4-digit numbers created by concatenating the digits reconstructed
 // from the hints.
 
+#include "lib/bitset.h"
 #include "lib/dbgprint.h"
+#include "lib/input.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 enum { CLASS069 = 10, CLASS235 = 20 };
 
-// Look up class by string length (index).
+// Look up class by segment count (index).
 //  Lengths 0, 1 ==> not possible (-1).
 //  Specific number is returned if it's that digit.
 //  So, for example, '2' is returned if it's exactly '2'.
@@ -18,66 +20,27 @@ static int lookup1478[8] = {
     -1, -1, 1, 7, 4, CLASS069, CLASS235, 8,
 };
 
-static int charcmp(void const *a, void const *b) {
-  int ca = *(char *)a;
-  int cb = *(char *)b;
-  return ca - cb;
-}
-
-static void qsortstr8(char *s) {
-  size_t ns = strnlen(s, 8);
-  qsort(s, ns, 1, charcmp);
-}
-
-// Calculate the simple character-set intersection represented
-// by nonduplicated sorted strings (a, b).
-// out is supposed to be allocated, and large enough to contain
-// 8 characters.
-static void strinter(const char *a, const char *b, char *out) {
-  while (*a != '\0' && *b != '\0') {
-    if (*a == *b) {
-      *out = *a;
-      out++;
-      a++;
-      b++;
-    } else if (*a < *b) {
-      a++;
-    } else {
-      b++;
-    }
+// The set of segments lit in a pattern, one bit per letter 'a' through 'g',
+// into (*set). Return false if the pattern is not up to 7 such letters.
+static bool segments(StrView s, uint64_t *set) {
+  *set = 0;
+  if (s.len > 7) {
+    return false;
   }
-}
-
-// out is supposed to be able to collect up to 8 characters.
-static void strunion(const char *a, const char *b, char *out) {
-  while (*a != '\0' && *b != '\0') {
-    if (*a == *b) {
-      *out = *a;
-      out++;
-      a++;
-      b++;
-    } else if (*a < *b) {
-      *out++ = *a++;
-    } else {
-      *out++ = *b++;
-    }
-  }
-  if (*a == '\0' && *b != '\0') {
-    while (*b != '\0') {
-      *out++ = *b++;
-    }
-  } else if (*a != '\0' && *b == '\0') {
-    while (*a != '\0') {
-      *out++ = *a++;
+  for (size_t i = 0; i < s.len; i++) {
+    if (s.p[i] < 'a' || s.p[i] > 'g') {
+      return false;
     }
+    *set |= (uint64_t)1 << (s.p[i] - 'a');
   }
+  return true;
 }
 
 // Return the index of the earliest occurrence of exact in array
 // through linear search at beginning or return -1 when not found.
-static int strmatch(const char *exact, char array[10][8]) {
+static int setmatch(uint64_t exact, uint64_t const array[10]) {
   for (size_t i = 0; i < 10; i++) {
-    if (strncmp(exact, array[i], 8) == 0) {
+    if (exact == array[i]) {
       return i;
     }
   }
@@ -102,8 +65,9 @@ static void putbd(Bidict *bd, int c, int i) {
 int main(void) {
   size_t nlines = 0;
   long sum = 0;
-  char patterns[10][8] = {0};
-  char queries[4][8] = {0};
+  StrView patterns[10];
+  StrView queries[4];
+  uint64_t sets[10], asked[4];
   Bidict bd;
 
   for (int i = 0; i < 10; i++) {
@@ -111,25 +75,38 @@ int main(void) {
     bd.indices[i] = -1;
   }
 
-  for (int scan = 0;
-       (scan = scanf(
-            "%7s %7s %7s %7s %7s %7s %7s %7s %7s %7s | %7s %7s %7s %7s",
-            patterns[0], patterns[1], patterns[2], patterns[3], patterns[4],
-            patterns[5], patterns[6], patterns[7], patterns[8], patterns[9],
-            queries[0], queries[1], queries[2], queries[3])) != EOF;
-       nlines++) {
+  Input *in = xopeninput(NULL);
+  for (; !inputdone(in); nlines++) {
+    // Ten patterns, a bar, then four queries.
+    StrView bar = {0};
+    int scan = 0;
+    while (scan < 10 && nexttoken(in, &patterns[scan])) {
+      scan++;
+    }
+    if (scan == 10 && nexttoken(in, &bar) && bar.len == 1 && *bar.p == '|') {
+      while (scan < 14 && nexttoken(in, &queries[scan - 10])) {
+        scan++;
+      }
+    }
     if (scan != 14) {
       fprintf(stderr, "Parse failure. expect %d words, get %d\n", 14, scan);
+      closeinput(in);
       return 1;
     }
+    for (int k = 0; k < 14; k++) {
+      StrView w = k < 10 ? patterns[k] : queries[k - 10];
+      if (!segments(w, k < 10 ? &sets[k] : &asked[k - 10])) {
+        fprintf(stderr, "Parse failure. bad pattern \"%.*s\"\n", PRIsv(w));
+        closeinput(in);
+        return 1;
+      }
+    }
 
     // Find 1, 4, 7 and 8.
     // Find the classes "10" and "20".
     // At completion all numbers are classed into one of the three classes.
     for (int p = 0; p < 10; p++) {
-      qsortstr8(patterns[p]);
-      size_t pattern_len = strnlen(patterns[p], 8);
-      int pattern_class = lookup1478[pattern_len];
+      int pattern_class = lookup1478[popcount64(sets[p])];
       if (pattern_class > 0 && pattern_class < 10) {
         putbd(&bd, pattern_class, p);
       }
@@ -154,11 +131,8 @@ int main(void) {
       if (c < 10) {
         continue;
       }
-      char uni1[8] = {0}, int4[8] = {0};
-      strunion(patterns[p], patterns[bd.indices[1]], uni1);
-      strinter(patterns[p], patterns[bd.indices[4]], int4);
-      int mat1 = strmatch(uni1, patterns);
-      int mat4 = strmatch(int4, patterns);
+      int mat1 = setmatch(sets[p] | sets[bd.indices[1]], sets);
+      int mat4 = setmatch(sets[p] & sets[bd.indices[4]], sets);
       if (mat1 == -1) {
         // dbgprintassoc(2, p);
         putbd(&bd, 2, p);
@@ -175,11 +149,8 @@ int main(void) {
       if (c < 10) {
         continue;
       }
-      char uni2[8] = {0}, int9[8] = {0};
-      strunion(patterns[p], patterns[bd.indices[2]], uni2);
-      strinter(patterns[p], patterns[bd.indices[9]], int9);
-      int mat2 = strmatch(uni2, patterns);
-      int mat9 = strmatch(int9, patterns);
+      int mat2 = setmatch(sets[p] | sets[bd.indices[2]], sets);
+      int mat9 = setmatch(sets[p] & sets[bd.indices[9]], sets);
       if (mat2 != -1 && c == 10) {
         // dbgprintassoc(5, p);
         putbd(&bd, 5, p);
@@ -210,19 +181,17 @@ int main(void) {
     // Lastly: process the queries.
     static long const rpowten[4] = {1000, 100, 10, 1};
     for (int q = 0; q < 4; q++) {
-      char sorted_query[8] = {0};
-      strncpy(sorted_query, queries[q], 7);
-      qsortstr8(sorted_query);
-      int ix = strmatch(sorted_query, patterns);
+      int ix = setmatch(asked[q], sets);
       int cl = bd.classes[ix];
       sum += rpowten[q] * cl;
       printf("%d", cl);
       dbgflush(stdout);
-      dbgprintf(" (unsorted \"%s\", sorted \"%s\")\n", queries[q],
-                sorted_query);
+      dbgprintf(" (query \"%.*s\", pattern \"%.*s\")\n", PRIsv(queries[q]),
+                PRIsv(patterns[ix]));
     }
     printf("\n");
   }
   printf("\nThe added up number is %lu.\n", sum);
+  closeinput(in);
   return 0;
 }
\ No newline at end of file
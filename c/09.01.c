@@ -5,7 +5,7 @@
 #include <string.h>
 
 #include "lib/dbgprint.h"
-#include "lib/xalloc.h"
+#include "lib/input.h"
 
 typedef struct boardsiz_t {
   int ncols;
@@ -17,7 +17,7 @@ static bool posgood(BoardSize const *bs, int col) {
   return true;
 }
 
-static bool locallow(BoardSize const *bs, int col, char *rows[3]) {
+static bool locallow(BoardSize const *bs, int col, char const *rows[3]) {
   int up, down, left, right, on;
   up = rows[0][col] - '0';
   down = rows[2][col] - '0';
@@ -31,15 +31,15 @@ static bool locallow(BoardSize const *bs, int col, char *rows[3]) {
 int main(void) {
   long sum = 0;
   int ln = 0;
-  int scan;
   BoardSize bs = {0};
-  char *lines[3];
-  lines[0] = xcalloc(1, sizeof(char));
-  lines[1] = xcalloc(1, sizeof(char));
-  lines[2] = xcalloc(1, sizeof(char));
+  // The rows point into the input buffer, which outlives them.
+  char const *lines[3] = {"", "", ""};
+  Input *in = xopeninput(NULL);
+  StrView tok;
 
-  for (; (scan = scanf("%ms ", &lines[2])) != EOF; ln++) {
-    dbgprintf("%d: %s\n", ln, lines[2]);
+  for (; nexttoken(in, &tok); ln++) {
+    lines[2] = tok.p;
+    dbgprintf("%d: %.*s\n", ln, PRIsv(tok));
 
     if (ln == 1) {
       // The second line --- look-behind is disabled.
@@ -50,24 +50,23 @@ int main(void) {
         down = lines[2][col] - '0';
         on = lines[1][col] - '0';
         if (on < left && on < right && on < down) {
-          dbgprintf("Row %d, column %d, line \"%7s\", character: '%c'\n",
-                    ln - 1, col, lines[1], lines[1][col]);
+          dbgprintf("Row %d, column %d, line \"%.*s\", character: '%c'\n",
+                    ln - 1, col, bs.ncols, lines[1], lines[1][col]);
           sum += on + 1;
         }
       }
     } else if (ln != 0) {
       for (int col = 0; col < bs.ncols; col++) {
         if (locallow(&bs, col, lines)) {
-          dbgprintf("Row %d, column %d, line \"%7s\", character: '%c'\n",
-                    ln - 1, col, lines[1], lines[1][col]);
+          dbgprintf("Row %d, column %d, line \"%.*s\", character: '%c'\n",
+                    ln - 1, col, bs.ncols, lines[1], lines[1][col]);
           sum += lines[1][col] - '0' + 1;
         }
       }
     } else {
-      bs.ncols = strlen(lines[2]);
+      bs.ncols = tok.len;
     }
 
-    free(lines[0]);
     lines[0] = lines[1];
     lines[1] = lines[2];
   }
@@ -83,15 +82,14 @@ int main(void) {
       up = lines[0][col] - '0';
       on = lines[1][col] - '0';
       if (on < left && on < right && on < up) {
-        dbgprintf("Row %d, column %d, line \"%7s\", character: '%c'\n", ln - 1,
-                  col, lines[1], lines[1][col]);
+        dbgprintf("Row %d, column %d, line \"%.*s\", character: '%c'\n",
+                  ln - 1, col, bs.ncols, lines[1], lines[1][col]);
         sum += on + 1;
       }
     }
   }
 
-  free(lines[0]);
-  free(lines[1]);
+  closeinput(in);
 
   printf("Sum: %ld.\n", sum);
   printf("Processing has ended. Thank you.\n");
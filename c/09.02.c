@@ -6,8 +6,11 @@
 #include <string.h>
 
 #include "lib/dbgprint.h"
+#include "lib/grid.h"
 #include "lib/iminmax.h"
+#include "lib/input.h"
 #include "lib/intvec.h"
+#include "lib/render.h"
 #include "lib/xalloc.h"
 
 typedef struct cursor_t {
@@ -15,12 +18,16 @@ typedef struct cursor_t {
   int col;
 } Cursor;
 
-static bool local_low(int ncols, int col, char *rows[3]) {
-  int up = rows[0] ? rows[0][col] - '0' : INT_MAX;
-  int down = rows[2] ? rows[2][col] - '0' : INT_MAX;
-  int left = (col > 0) ? rows[1][col - 1] - '0' : INT_MAX;
-  int right = (col < ncols - 1) ? rows[1][col + 1] - '0' : INT_MAX;
-  int on = rows[1][col] - '0';
+// Higher than any height, so the halo is never lower than a neighbor and never
+// in a basin.
+#define WALL 10
+
+static bool local_low(Grid const *g, Stencil n4, ptrdiff_t i) {
+  int on = g->cells[i];
+  int up = g->cells[i + n4.d[0]];
+  int down = g->cells[i + n4.d[1]];
+  int left = g->cells[i + n4.d[2]];
+  int right = g->cells[i + n4.d[3]];
   if (on < up && on < down && on < left && on < right) {
     dbgprintf("v\tup = %d, down = %d, left = %d, right = %d\n", up, down, left,
               right);
@@ -28,53 +35,6 @@ static bool local_low(int ncols, int col, char *rows[3]) {
   return on < up && on < down && on < left && on < right;
 }
 
-typedef struct strgrid_t {
-  char **grid;
-  int nrows;
-  int capacity;
-} StringGrid;
-
-static StringGrid mkstrgrid() {
-  StringGrid sg = {
-      .grid = xcalloc(1, sizeof(char *)), .nrows = 0, .capacity = 1};
-  return sg;
-}
-
-static void delstrgrid(StringGrid sg) {
-  for (int r = 0; r < sg.nrows; r++) {
-    free(sg.grid[r]);
-  }
-  free(sg.grid);
-}
-
-// Move a preallocated C-string into the string grid.
-static void movstrgrid(StringGrid *sg, char *line) {
-  if (sg->nrows == sg->capacity) {
-    sg->capacity *= 2;
-    sg->grid = xrealloc(sg->grid, sg->capacity * sizeof(char *));
-  }
-  sg->grid[sg->nrows++] = line;
-}
-
-typedef struct strgrid_aux_t {
-  int row_length;
-  StringGrid *sg;
-} StringGridAux;
-
-// Find the integer representation of the character (eg. '1' -> 1).
-// If nonexistent, return INT_MAX.
-static int i_sgat(StringGridAux sga, Cursor co) {
-  if (co.row < 0 || co.row >= sga.sg->nrows) {
-    return INT_MAX;
-  }
-
-  if (co.col < 0 || co.col >= sga.row_length) {
-    return INT_MAX;
-  }
-
-  return sga.sg->grid[co.row][co.col] - '0';
-}
-
 typedef struct vcursor_t {
   Cursor *cos;
   int len;
@@ -108,80 +68,41 @@ static int srcvcursor(VectorCursor *vc, Cursor co) {
   return -1;
 }
 
-typedef struct indexgrid_t {
-  int *indices;
-  int width;
-  int height;
-} IndexGrid;
-
-static IndexGrid mkigrid(int width, int height) {
-  IndexGrid lg = {.width = width,
-                  .height = height,
-                  .indices = xmalloc(width * height * sizeof(int))};
-  for (int r = 0; r < lg.height; r++) {
-    for (int c = 0; c < lg.width; c++) {
-      lg.indices[r * lg.width + c] = -1;
-    }
+// Find the basin of the cell at index (i): the low point (as an index into
+// (low_points)) that it drains into, going downhill greedily. The halo is
+// higher than any cell, so the walk never leaves the grid. Results are kept
+// in (basins), where -2 means not yet known. Return -1 for no basin.
+static int greedy_find_basin(Grid const *g, int *basins,
+                             VectorCursor *low_points, ptrdiff_t i) {
+  if (basins[i] != -2) {
+    return basins[i];
   }
-  return lg;
-}
-
-static void deligrid(IndexGrid lg) { free(lg.indices); }
-
-static int igat(IndexGrid *lg, Cursor co) {
-  if (co.row < 0 || co.row >= lg->height)
-    return -1;
-  if (co.col < 0 || co.col >= lg->width)
-    return -1;
-  return lg->indices[co.row * lg->width + co.col];
-}
-
-static int greedy_find_basin(StringGrid *sg, IndexGrid *lg,
-                             VectorCursor *low_points, Cursor co) {
-  if (igat(lg, co) != -1) {
-    return igat(lg, co);
-  }
-
-  StringGridAux sga = {.row_length = lg->width, .sg = sg};
 
-  int on = i_sgat(sga, co);
-  if (on == -1) {
-    return -1;
-  }
+  int on = g->cells[i];
+  int basin;
   if (on == 9) {
-    return -1;
-  }
-  if (on == 0) {
-    return srcvcursor(low_points, co);
-  }
-
-  Cursor cup = {.row = co.row - 1, .col = co.col};
-  Cursor cdown = {.row = co.row + 1, .col = co.col};
-  Cursor cleft = {.row = co.row, .col = co.col - 1};
-  Cursor cright = {.row = co.row, .col = co.col + 1};
-
-  int up = i_sgat(sga, cup);
-  int down = i_sgat(sga, cdown);
-  int left = i_sgat(sga, cleft);
-  int right = i_sgat(sga, cright);
-
-  if (up < on) {
-    return greedy_find_basin(sg, lg, low_points, cup);
-  }
-
-  if (down < on) {
-    return greedy_find_basin(sg, lg, low_points, cdown);
-  }
-
-  if (left < on) {
-    return greedy_find_basin(sg, lg, low_points, cleft);
-  }
-
-  if (right < on) {
-    return greedy_find_basin(sg, lg, low_points, cright);
+    basin = -1;
+  } else if (on == 0) {
+    Cursor co = {.row = gridrow(g, i), .col = gridcol(g, i)};
+    basin = srcvcursor(low_points, co);
+  } else {
+    // Up, down, left, right: the first that is lower.
+    ptrdiff_t next = i;
+    FORSTENCIL(j, i, gridn4(g)) {
+      if (g->cells[j] < on) {
+        next = j;
+        break;
+      }
+    }
+    if (next != i) {
+      basin = greedy_find_basin(g, basins, low_points, next);
+    } else {
+      Cursor co = {.row = gridrow(g, i), .col = gridcol(g, i)};
+      basin = srcvcursor(low_points, co);
+    }
   }
-
-  return srcvcursor(low_points, co);
+  basins[i] = basin;
+  return basin;
 }
 
 static int intcmp_desc(void const *a, void const *b) {
@@ -192,54 +113,25 @@ static int intcmp_desc(void const *a, void const *b) {
 
 int main(void) {
   long sum = 0;
-  int scan = 0;
-  char *line = 0;
-  size_t line_length = 0;
-  StringGrid sg = mkstrgrid();
+  Grid g = xloaddigitgrid(xopeninput(NULL), 1, WALL);
 
-  for (; (scan = scanf("%ms ", &line)) != EOF;) {
-    movstrgrid(&sg, line);
-  }
-
-  printf("Read %d lines.\n", sg.nrows);
+  printf("Read %d lines.\n", g.height);
 
-  if (sg.nrows <= 2) {
+  if (g.height <= 2) {
     fprintf(stderr, "More than 2 lines must be supplied. Error!\n");
+    freegrid(g);
     return 1;
   }
 
-  line_length = strlen(sg.grid[0]);
-
   VectorCursor vc = mkvcursor();
-
-  for (int r = 0; r < sg.nrows; r++) {
-    char *lines[3] = {0};
-
-    if (r == 0) {
-      lines[0] = NULL;
-      lines[1] = sg.grid[r];
-      lines[2] = sg.grid[r + 1];
-      assert(lines[1]);
-      assert(lines[2]);
-    } else if (r == sg.nrows - 1) {
-      lines[0] = sg.grid[r - 1];
-      lines[1] = sg.grid[r];
-      lines[2] = NULL;
-      assert(lines[0]);
-      assert(lines[1]);
-    } else {
-      lines[0] = sg.grid[r - 1];
-      lines[1] = sg.grid[r];
-      lines[2] = sg.grid[r + 1];
-      assert(lines[0]);
-      assert(lines[1]);
-      assert(lines[2]);
-    }
-
-    for (int c = 0; c < line_length; c++) {
-      if (local_low(line_length, c, lines)) {
-        dbgprintf("Found r %d, c %d '%c'\n", r, c, lines[1][c]);
-        sum += lines[1][c] - '0' + 1;
+  Stencil n4 = gridn4(&g);
+
+  for (int r = 0; r < g.height; r++) {
+    for (int c = 0; c < g.width; c++) {
+      ptrdiff_t i = gridindex(&g, r, c);
+      if (local_low(&g, n4, i)) {
+        dbgprintf("Found r %d, c %d (%d)\n", r, c, g.cells[i]);
+        sum += g.cells[i] + 1;
         insvcursor(&vc, (Cursor){.row = r, .col = c});
       }
     }
@@ -250,45 +142,55 @@ int main(void) {
   // Time to do the secondary processing, which is to assign to each number the
   // basin number. The basin numbers are to be printed in a grid structure.
 
-  IndexGrid ig = mkigrid(line_length, sg.nrows);
+  int *basins = xmkgridlayer(&g, sizeof(int));
+  for (size_t k = 0; k < gridsize(&g); k++) {
+    basins[gridlo(&g) + (ptrdiff_t)k] = -2;
+  }
   int *basin_freqs = xcalloc(vc.len, sizeof(int));
 
-  dbgprintf("\nBasin chart (need big screen):\n");
-  dbgprintf("%4s ", "");
-  for (int c = 0; c < line_length; c++) {
-    dbgprintf("[%2d] ", c);
+  Frame *chart = xmkdbgframe();
+  frameputs(chart, "\nBasin chart (need big screen):\n     ");
+  for (int c = 0; c < g.width; c++) {
+    framechar(chart, '[');
+    frameint(chart, c, 2);
+    frameputs(chart, "] ");
   }
-  dbgprintf("\n");
+  framechar(chart, '\n');
 
   int dbg_n_buggy = 0;
-  for (int r = 0; r < sg.nrows; r++) {
-    dbgprintf("[%2d] ", r);
-    for (int c = 0; c < line_length; c++) {
-      Cursor co = {.row = r, .col = c};
-      int basin = greedy_find_basin(&sg, &ig, &vc, co);
-      char ch = sg.grid[r][c];
-      if (ch == '9') {
-        dbgprintf("%3s  ", "X");
+  for (int r = 0; r < g.height; r++) {
+    framechar(chart, '[');
+    frameint(chart, r, 2);
+    frameputs(chart, "] ");
+    for (int c = 0; c < g.width; c++) {
+      ptrdiff_t i = gridindex(&g, r, c);
+      int basin = greedy_find_basin(&g, basins, &vc, i);
+      int ch = g.cells[i];
+      if (ch == 9) {
+        frameputs(chart, "  X  ");
       } else if (basin == -1) {
-        dbgprintf("%3s  ", ".");
+        frameputs(chart, "  .  ");
         dbg_n_buggy++;
       } else {
         basin_freqs[basin]++;
-        dbgprintf("%3d  ", basin);
+        frameint(chart, basin, 3);
+        frameputs(chart, "  ");
       }
     }
-    dbgprintf("\n");
+    framechar(chart, '\n');
   }
-  dbgprintf("\n* X = the character was '9', so no basin assigned.\n"
+  flushframe(chart);
+  freeframe(chart);
+  dbgprintf("\n* X = the height was 9, so no basin assigned.\n"
             "* . = Unassigned (due to a bug; %d found).\n",
             dbg_n_buggy);
 
   dbgprintf("\nGrid legend:\n");
   for (int i = 0; i < vc.len; i++) {
     Cursor co = vc.cos[i];
-    char ch = sg.grid[co.row][co.col];
-    dbgprintf("[%2d] @ (r %2d, c %2d) '%c' (%d found)\n", i, co.row, co.col, ch,
-              basin_freqs[i]);
+    int ch = *gridat(&g, co.row, co.col);
+    dbgprintf("[%2d] @ (r %2d, c %2d) (%d) (%d found)\n", i, co.row, co.col,
+              ch, basin_freqs[i]);
   }
 
   dbgprintf("\nTop 3 basin sizes:\n");
@@ -303,7 +205,7 @@ int main(void) {
   printf("Product: %ld\n", basin_top3);
 
   free(basin_freqs);
-  deligrid(ig);
+  freegridlayer(&g, basins, sizeof(int));
   delvcursor(vc);
-  delstrgrid(sg);
+  freegrid(g);
 }
@@ -5,6 +5,7 @@
 
 #include "lib/charvec.h"
 #include "lib/dbgprint.h"
+#include "lib/input.h"
 
 bool isopening(char c) { return c == '(' || c == '[' || c == '{' || c == '<'; }
 
@@ -42,10 +43,12 @@ long closingscore(char c) {
 
 int main(void) {
   long total_score = 0;
-  int scan, iline;
-  char *line;
-  for (iline = 0; (scan = scanf("%ms ", &line)) != EOF; iline++) {
-    size_t llen = strlen(line);
+  int iline;
+  Input *in = xopeninput(NULL);
+  StrView tok;
+  for (iline = 0; nexttoken(in, &tok); iline++) {
+    char const *line = tok.p;
+    size_t llen = tok.len;
     long illegal_score = 0;
     CharVec *cv = xmkcharvec();
 
@@ -70,8 +73,8 @@ int main(void) {
       dbgprintf("\nLine %-4d ... score was %ld\n\n", iline, illegal_score);
 
     freecharvec(cv);
-    free(line);
   }
+  closeinput(in);
 
   printf("%d lines processed, total score %ld.\n", iline, total_score);
 }
@@ -6,6 +6,7 @@
 
 #include "lib/charvec.h"
 #include "lib/dbgprint.h"
+#include "lib/input.h"
 #include "lib/longvec.h"
 
 bool isopening(char c) { return c == '(' || c == '[' || c == '{' || c == '<'; }
@@ -56,10 +57,12 @@ static int longcmp(void const *a, void const *b) {
 
 int main(void) {
   LongVec *scores = xmklongvec();
-  int scan, iline;
-  char *line;
-  for (iline = 0; (scan = scanf("%ms ", &line)) != EOF; iline++) {
-    size_t llen = strlen(line);
+  int iline;
+  Input *in = xopeninput(NULL);
+  StrView tok;
+  for (iline = 0; nexttoken(in, &tok); iline++) {
+    char const *line = tok.p;
+    size_t llen = tok.len;
     CharVec *cv = xmkcharvec();
 
     for (int i = 0; i < llen; i++) {
@@ -79,8 +82,8 @@ int main(void) {
     }
 
     if (cv->len) {
-      dbgprintf("Line %d is incomplete; it will be filled.\n\t\"%s ... ", iline,
-                line);
+      dbgprintf("Line %d is incomplete; it will be filled.\n\t\"%.*s ... ",
+                iline, PRIsv(tok));
       long local_points = 0;
       while (cv->len) {
         char ec = xpopcharvec(cv);
@@ -96,8 +99,8 @@ int main(void) {
   end_line:
 
     freecharvec(cv);
-    free(line);
   }
+  closeinput(in);
 
   qsort(scores->xs, scores->len, sizeof(long), longcmp);
   long median_score = scores->xs[scores->len / 2];
@@ -0,0 +1,228 @@
+// Day 11 for many boards at once. The boards come from the file named on the
+// command line, or standard input, one after another with a blank line
+// between, and must all be the same size. They are stepped together (see
+// OctoBatch in lib/octopus.h), and for each a line gives the flashes in the
+// first -n steps (100) and the first step on which all its octopuses flash,
+// or 0 if none has by step -m (100000). A board seen to come back to an
+// earlier state without all flashing never will, and is done with early; those
+// done with are dropped from the batch as it goes.
+// With -s, each board is stepped on its own instead, for comparison.
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lib/grid.h"
+#include "lib/input.h"
+#include "lib/octopus.h"
+#include "lib/xalloc.h"
+
+#define WALL SCHAR_MIN
+
+static void usage(char const *argv0) {
+  fprintf(stderr, "Usage: %s [-n steps] [-m max] [-s] [boards]\n", argv0);
+}
+
+// Count the boards in (in), and check they are all (width) by (height).
+// Return 0 if they are not.
+static int countboards(Input *in, int *width, int *height) {
+  StrView line;
+  int boards = 0, rows = 0;
+  *width = *height = 0;
+  while (nextline(in, &line)) {
+    if (!line.len) {
+      if (rows && (boards++ ? rows != *height : (*height = rows, false))) {
+        return 0;
+      }
+      rows = 0;
+      continue;
+    }
+    if (!*width) {
+      *width = line.len;
+    }
+    if ((int)line.len != *width) {
+      return 0;
+    }
+    rows++;
+  }
+  if (rows && (boards++ ? rows != *height : (*height = rows, false))) {
+    return 0;
+  }
+  return boards;
+}
+
+// Load the boards of (in) into (b).
+static void loadboards(Input *in, OctoBatch *b) {
+  StrView line;
+  int board = 0, r = 0;
+  in->pos = 0;
+  while (nextline(in, &line)) {
+    if (!line.len) {
+      board += r > 0;
+      r = 0;
+      continue;
+    }
+    for (int c = 0; c < b->width; c++) {
+      *octobatchat(b, board, r, c) = line.p[c] - '0';
+    }
+    r++;
+  }
+}
+
+// A batch of the boards of (b) still to step, listed in (ids) by lane, which
+// (ids) is updated to. Free (b).
+static OctoBatch compact(OctoBatch *b, int *ids, bool const *done) {
+  int n = 0;
+  for (int j = 0; j < b->boards; j++) {
+    n += !done[ids[j]];
+  }
+  OctoBatch c = xmkoctobatch(b->width, b->height, n, OCTO_AUTO);
+  n = 0;
+  for (int j = 0; j < b->boards; j++) {
+    if (done[ids[j]]) {
+      continue;
+    }
+    for (int r = 0; r < b->height; r++) {
+      for (int col = 0; col < b->width; col++) {
+        *octobatchat(&c, n, r, col) = *octobatchat(b, j, r, col);
+      }
+    }
+    ids[n++] = ids[j];
+  }
+  freeoctobatch(b);
+  return c;
+}
+
+// Mark in (same) the boards of (b) that are as in (snap), a copy of its cells.
+static void sameboards(OctoBatch const *b, signed char const *snap,
+                       bool *same) {
+  for (int j = 0; j < b->boards; j++) {
+    same[j] = true;
+  }
+  for (int p = 0; p < b->width * b->height; p++) {
+    signed char const *x = b->cells + (size_t)p * b->lanes;
+    signed char const *y = snap + (size_t)p * b->lanes;
+    for (int j = 0; j < b->boards; j++) {
+      same[j] &= x[j] == y[j];
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  long steps = 100, max = 100000;
+  bool serial = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:m:s")) != -1) {
+    switch (opt) {
+    case 'n':
+      steps = atol(optarg);
+      break;
+    case 'm':
+      max = atol(optarg);
+      break;
+    case 's':
+      serial = true;
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (optind < argc - 1 || steps < 0 || max < 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  Input *in = xopeninput(optind < argc ? argv[optind] : NULL);
+  int width, height;
+  int boards = countboards(in, &width, &height);
+  if (!boards) {
+    fprintf(stderr, "The boards are not all the same size\n");
+    return 1;
+  }
+  OctoBatch b = xmkoctobatch(width, height, boards, OCTO_AUTO);
+  loadboards(in, &b);
+  closeinput(in);
+
+  long *flashes = xcalloc(boards, sizeof(long));
+  long *allflash = xcalloc(boards, sizeof(long));
+  int *stepflash = xcalloc(boards, sizeof(int));
+  int cells = width * height;
+  if (serial) {
+    Grid g = xmkgrid(width, height, 1, WALL);
+    for (int j = 0; j < boards; j++) {
+      for (int r = 0; r < height; r++) {
+        for (int c = 0; c < width; c++) {
+          *gridat(&g, r, c) = *octobatchat(&b, j, r, c);
+        }
+      }
+      Octopuses o = xmkoctopuses(&g, OCTO_AUTO);
+      for (long step = 1; step <= max && (step <= steps || !allflash[j]);
+           step++) {
+        int n = octostep(&o);
+        flashes[j] += step <= steps ? n : 0;
+        if (n == cells && !allflash[j]) {
+          allflash[j] = step;
+        }
+      }
+      freeoctopuses(&o);
+    }
+    freegrid(g);
+  } else {
+    // Past step -n, a board is done once all its octopuses have flashed, or
+    // once it repeats. Repeats are found as Brent does, against a copy of the
+    // boards taken at steps that double.
+    int *ids = xcalloc(boards, sizeof(int));
+    bool *done = xcalloc(boards, sizeof(bool));
+    bool *cycled = xcalloc(boards, sizeof(bool));
+    bool *same = xcalloc(boards, sizeof(bool));
+    size_t size = (size_t)cells * b.lanes;
+    signed char *snap = xmalloc(size);
+    memcpy(snap, b.cells, size);
+    for (int j = 0; j < boards; j++) {
+      ids[j] = j;
+    }
+    int left = boards;
+    long snapat = 1;
+    for (long step = 1; step <= max && left; step++) {
+      octobatchstep(&b, stepflash);
+      sameboards(&b, snap, same);
+      for (int j = 0; j < b.boards; j++) {
+        int id = ids[j];
+        flashes[id] += step <= steps ? stepflash[j] : 0;
+        if (stepflash[j] == cells && !allflash[id]) {
+          allflash[id] = step;
+        }
+        cycled[id] |= same[j];
+        if (!done[id] && (allflash[id] || cycled[id]) && step >= steps) {
+          done[id] = true;
+          left--;
+        }
+      }
+      if (left <= b.lanes / 2 - 32) {
+        b = compact(&b, ids, done);
+        snapat = step;
+      }
+      if (step == snapat) {
+        memcpy(snap, b.cells, (size_t)cells * b.lanes);
+        snapat *= 2;
+      }
+    }
+    free(ids);
+    free(done);
+    free(cycled);
+    free(same);
+    free(snap);
+  }
+
+  for (int j = 0; j < boards; j++) {
+    printf("%d %ld %ld\n", j, flashes[j], allflash[j]);
+  }
+  free(flashes);
+  free(allflash);
+  free(stepflash);
+  freeoctobatch(&b);
+  return 0;
+}
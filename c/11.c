@@ -1,181 +1,267 @@
 #include <assert.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
 #include "lib/dbgprint.h"
+#include "lib/grid.h"
+#include "lib/input.h"
+#include "lib/octopus.h"
+#include "lib/octoslice.h"
+#include "lib/render.h"
 #include "lib/xalloc.h"
 
-#define TEXTBOLD "\033[1m"
-#define TEXTNORMAL "\033[0m"
+// A sentinel below anything an octopus can hold, so the halo never flashes.
+#define WALL SCHAR_MIN
 
-typedef struct grid_t {
-  // Ordinary numbers (integers), not characters.
-  signed char *grid;
-  int width, height;
-} Grid;
-
-#define FORRC(r, rlim, c, clim)                                                \
-  for (int r = 0; r < rlim; r++)                                               \
-    for (int c = 0; c < clim; c++)
-
-typedef struct cursor_t {
-  int row, column;
-} Cursor;
-
-#define mkcur(r, c) ((Cursor){.row = (r), .column = (c)})
-
-static void initgrid(Grid *g) {
-  g->grid = NULL;
-  g->width = 0;
-  g->height = 0;
+// Render the grid into (f), with the octopuses that just flashed (zero) in
+// bold.
+static void dbggrid(Frame *f, Grid *g) {
+  if (!f) {
+    return;
+  }
+  for (int r = 0; r < g->height; r++) {
+    framechar(f, '\n');
+    for (int c = 0; c < g->width; c++) {
+      signed char ch = *gridat(g, r, c);
+      framestyle(f, ch ? STYLE_NORMAL : STYLE_BOLD);
+      framechar(f, "0123456789abcdef"[ch & 15]);
+    }
+    framestyle(f, STYLE_NORMAL);
+  }
+  framechar(f, '\n');
+  flushframe(f);
 }
 
-static void delgrid(Grid g) { free(g.grid); }
-
-static signed char *at(Grid *g, Cursor c) {
-  if (c.column < 0 || c.column >= g->width)
-    return NULL;
-  if (c.row < 0 || c.row >= g->height)
-    return NULL;
-  return &g->grid[c.column + c.row * g->width];
+static bool samegrid(Grid const *a, Grid const *b) {
+  for (int r = 0; r < a->height; r++) {
+    if (memcmp(gridat(a, r, 0), gridat(b, r, 0), a->width)) {
+      return false;
+    }
+  }
+  return true;
 }
 
-static void dbggrid(Grid *g) {
-#ifndef NDEBUG
-  int tty = isatty(STDERR_FILENO);
-#else
-  int tty = 0;
-#endif
-  char const *normal = tty ? TEXTNORMAL : "";
-  char const *boldtext = tty ? TEXTBOLD : "";
-  signed char ch;
-  bool bold;
-  FORRC(r, g->height, c, g->width) {
-    Cursor co = mkcur(r, c);
-    ch = *at(g, co);
-    if (!c) {
-      if (bold) {
-        dbgprintf(normal);
-      }
-      bold = false;
-      dbgprintf("\n");
-    }
-    if (ch && bold) {
-      bold = false;
-      dbgprintf(normal);
-    }
-    if (!ch && !bold) {
-      bold = true;
-      dbgprintf(boldtext);
-    }
+static void usage(char const *argv0) {
+  fprintf(stderr,
+          "Usage: %s [-n step] [-m max] [-c checkpoint] [-k every] "
+          "[-t threads | -b]\n",
+          argv0);
+}
 
-    dbgprintf("%1x", ch);
-  }
+// Whichever way of stepping the board was asked for. The grid is kept up to
+// date, except by the bit-sliced board, which writes it back when asked.
+typedef struct {
+  Grid *g;
+  Octopuses o;
+  OctoTiles *tiles;
+  OctoSlice slice;
+  bool sliced;
+} Engine;
 
-  if (bold) {
-    dbgprintf(normal);
+static long enginestep(Engine *e) {
+  if (e->tiles) {
+    return octotilestep(e->tiles);
   }
-  dbgprintf("\n");
+  return e->sliced ? octoslicestep(&e->slice) : octostep(&e->o);
 }
 
-// Copy ASCII numeral rows (C-string) into the grid.
-static void cpyrawrow(Grid *g, char const *restrict row) {
-  size_t ll = g->width ? g->width : strlen(row);
-  size_t sz = (size_t)g->width * (size_t)g->height;
-  size_t nsz = sz + ll;
-  g->grid = xrealloc(g->grid, nsz);
-  g->width = g->width ? g->width : ll;
-  g->height++;
-
-  for (int i = 0; i < g->width; i++) {
-    g->grid[sz + i] = (int)row[i] - '0';
-    assert(g->grid[sz + i] >= 0);
-    assert(g->grid[sz + i] <= 9);
-  }
+static uint64_t enginehash(Engine const *e) {
+  return e->sliced ? octoslicehash(&e->slice) : octohash(e->g);
 }
 
-static void incall(Grid *g) {
-  FORRC(r, g->height, c, g->width) {
-    Cursor co = mkcur(r, c);
-    (*at(g, co)) += 1;
+// Bring the grid up to date.
+static void enginegrid(Engine *e) {
+  if (e->sliced) {
+    octoslicegrid(&e->slice, e->g);
   }
 }
 
-static void truncall(Grid *g) {
-  FORRC(r, g->height, c, g->width) {
-    Cursor co = mkcur(r, c);
-    signed char *x = at(g, co);
-    *x = (*x > 9 || *x < 0) ? 0 : *x;
+static void freeengine(Engine *e) {
+  if (e->tiles) {
+    freeoctotiles(e->tiles);
+  } else if (e->sliced) {
+    freeoctoslice(&e->slice);
+  } else {
+    freeoctopuses(&e->o);
   }
 }
 
-// For any element who is above 9, increment all adjacent elements by 1.
-// Elements are not truncated. Mark those already flashed with a negative
-// number. Return nonnegative if and only if at least one octopus flashed.
-// Return value is always nonnegative.
-static int flashall(Grid *g) {
-  int flash = 0;
-  FORRC(r, g->height, c, g->width) {
-    signed char *gg = at(g, mkcur(r, c));
-    if (*gg > 9) {
-      flash++;
-      *gg = -1;
-      FORRC(rr, 3, cc, 3) {
-        if (rr == 1 && cc == 1)
-          continue;
-        signed char *mm = at(g, mkcur(r + rr - 1, c + cc - 1));
-        if (mm && *mm >= 0)
-          (*mm)++;
-      }
+// Day 11 counts the flashes in the first (-n) steps, and finds the first step
+// on which all octopuses flash. Once the board repeats, both follow from the
+// steps taken, however far off (-n) is. Without -n, the count is for 100
+// steps, if all octopuses have not flashed at once by then and the run did
+// not resume past it. All octopuses flashing at once is looked for up to step
+// (-m) (100000), or (-n) if that is further.
+//
+// With -c, the run resumes from the checkpoint at that path if there is one,
+// and saves one there every (-k) steps, up to step (-n) if given, so that a
+// later run can go on to a further (-n). With -t, the board is split into
+// tiles stepped on that many threads (0: one per CPU); with -b, it is
+// bit-sliced.
+int main(int argc, char *argv[]) {
+  long target = 100, max = 100000, every = 100000;
+  int nthreads = -1;
+  bool hastarget = false, sliced = false;
+  char const *ckpt = NULL;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:m:c:k:t:b")) != -1) {
+    switch (opt) {
+    case 'n':
+      target = atol(optarg);
+      hastarget = true;
+      break;
+    case 'm':
+      max = atol(optarg);
+      break;
+    case 'c':
+      ckpt = optarg;
+      break;
+    case 'k':
+      every = atol(optarg);
+      break;
+    case 't':
+      nthreads = atoi(optarg);
+      nthreads = nthreads > 0 ? nthreads : 0;
+      break;
+    case 'b':
+      sliced = true;
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
     }
   }
-  return flash;
-}
-
-int main(void) {
-  Grid g;
-  initgrid(&g);
+  if (optind < argc || target < 0 || max < 0 || every < 1 ||
+      (sliced && nthreads >= 0)) {
+    usage(argv[0]);
+    return 1;
+  }
 
-  char *line;
-  for (int scan = 0; (scan = scanf("%ms ", &line)) != EOF; free(line)) {
-    cpyrawrow(&g, line);
+  Frame *dbg = xmkdbgframe();
+  Grid g = xloaddigitgrid(xopeninput(NULL), 1, WALL);
+  OctoProgress p = {0};
+  if (ckpt && access(ckpt, F_OK) == 0) {
+    p = xloadocto(ckpt, &g);
+    dbgprintf("Resumed from %s after step %ld\n", ckpt, p.step);
+  }
+  if (target < p.step) {
+    if (hastarget) {
+      fprintf(stderr, "The checkpoint is at step %ld, past step %ld\n", p.step,
+              target);
+      return 1;
+    }
+    target = -1;
   }
 
   dbgprintf("Before any steps:");
-  dbggrid(&g);
+  dbggrid(dbg, &g);
   dbgprintf("\n");
 
-  int all_flash = g.width * g.height;
-  int flash = 0;
-  for (int step = 1;; step++) {
-    int step_flash = 0, local_flash = 0;
-    incall(&g);
-    while ((local_flash = flashall(&g))) {
-      step_flash += local_flash;
+  Engine e = {.g = &g, .sliced = sliced};
+  if (nthreads >= 0) {
+    e.tiles = xmkoctotiles(&g, nthreads);
+    dbgprintf("Stepping %d tiles\n", octotiles(e.tiles));
+  } else if (sliced) {
+    e.slice = xmkoctoslice(&g);
+  } else {
+    e.o = xmkoctopuses(&g, OCTO_AUTO);
+  }
+
+  // Repeats are found as Brent does: the board is copied at steps further and
+  // further apart, 1, 2, 4, ... steps on, and compared, by hash and then
+  // cell by cell, with each board up to the next copy. The first that
+  // matches comes (period) steps after the copy, so memory stays the same
+  // however long the run.
+  Grid copy = xmkgrid(g.width, g.height, 0, 0);
+  uint64_t copyhash = 0;
+  long copyflashes = 0, since = 0, span = 0, period = 0, cycle = 0;
+
+  long total = target == p.step ? p.flashes : -1;
+  long all_flash = (long)g.width * g.height;
+  while (!period && ((hastarget && target > p.step) ||
+                     (!p.allflash && max > p.step))) {
+    if (since == span) {
+      enginegrid(&e);
+      for (int r = 0; r < g.height; r++) {
+        memcpy(gridat(&copy, r, 0), gridat(&g, r, 0), g.width);
+      }
+      copyhash = enginehash(&e);
+      copyflashes = p.flashes;
+      since = 0;
+      span = span ? 2 * span : 1;
+    }
+    long step = ++p.step;
+    long step_flash = enginestep(&e);
+    p.flashes += step_flash;
+    since++;
+    if (step == target) {
+      total = p.flashes;
+    }
+    if (step_flash == all_flash && !p.allflash) {
+      p.allflash = step;
     }
-    flash += step_flash;
-    truncall(&g);
     if (step <= 10 || step % 10 == 0 || step_flash == all_flash) {
-      dbgprintf("After step %d:", step);
-      dbggrid(&g);
+      dbgprintf("After step %ld:", step);
+      if (dbg) {
+        enginegrid(&e);
+      }
+      dbggrid(dbg, &g);
       dbgprintf("\n");
     }
-    if (step == 100) {
-      dbgflush(stderr);
-      printf("After 100 steps, %d flashes were found.\n", flash);
-      dbgflush(stdin);
+
+    if (enginehash(&e) == copyhash) {
+      enginegrid(&e);
+      if (samegrid(&g, &copy)) {
+        period = since;
+        cycle = p.flashes - copyflashes;
+        dbgprintf("The board repeats every %ld steps from step %ld\n",
+                  period, step - period);
+      }
+    }
+    if (ckpt && step % every == 0 && (!hastarget || step <= target)) {
+      enginegrid(&e);
+      xsaveocto(ckpt, &g, p);
     }
-    if (step_flash == all_flash) {
-      dbgflush(stderr);
-      printf("On step %d, all octopuses flash (%d)\n", step, step_flash);
-      dbgflush(stdin);
-      break;
+  }
+  freegrid(copy);
+
+  // Past the steps taken, whole periods each add the flashes of one, and the
+  // steps of the part period left are taken.
+  if (period && target > p.step) {
+    long rest = (target - p.step) % period;
+    if (__builtin_mul_overflow((target - p.step) / period, cycle, &total) ||
+        __builtin_add_overflow(total, p.flashes, &total)) {
+      fprintf(stderr, "Too many flashes to count\n");
+      return 1;
+    }
+    for (long k = 0; k < rest; k++) {
+      if (__builtin_add_overflow(total, enginestep(&e), &total)) {
+        fprintf(stderr, "Too many flashes to count\n");
+        return 1;
+      }
     }
   }
 
-  delgrid(g);
+  dbgflush(stderr);
+  if (total >= 0) {
+    printf("After %ld steps, %ld flashes were found.\n", target, total);
+  }
+  if (p.allflash) {
+    printf("On step %ld, all octopuses flash (%ld)\n", p.allflash, all_flash);
+  } else if (period) {
+    printf("The octopuses never all flash at once\n");
+  } else {
+    printf("The octopuses do not all flash at once by step %ld\n", p.step);
+  }
+  dbgflush(stdin);
+
+  freeengine(&e);
+  freegrid(g);
+  freeframe(dbg);
   return 0;
 }
@@ -1,147 +1,151 @@
 #include <assert.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "lib/bitset.h"
 #include "lib/dbgprint.h"
-#include "lib/iminmax.h"
+#include "lib/dots.h"
+#include "lib/input.h"
+#include "lib/pack.h"
+#include "lib/parseint.h"
+#include "lib/render.h"
 #include "lib/xalloc.h"
 
+// Coordinates parsed per call to parselongs(); even, so pairs stay whole.
+#define BATCH 4096
+
+// Sheets of more cells than this are too big to show for debugging.
+#define DBGCELLS (1L << 20)
+
 typedef enum {
   FOLD_LEFT,
   FOLD_UP,
 } Fold;
 
-typedef struct {
-  char *xs;
-  long width, height;
-} Grid;
-
-#define FORRC(r, r_max, c, c_max)                                              \
-  for (long r = 0; r < r_max; r++)                                             \
-    for (long c = 0; c < c_max; c++)
-
-#define at(g, c, r) ((g).xs[((c) + (r) * ((g).width))])
-
-static void dbg_grid(Grid *g) {
-  long counter = 0;
-  FORRC(r, g->height, c, g->width) {
-    if (counter == (g->width - 1)) {
-      dbgprintf("%c\n", at(*g, c, r));
-      counter = 0;
-    } else {
-      dbgprintf("%c", at(*g, c, r));
-      counter++;
-    }
+// Render the sheet into (f), one row of '#' (dot) and '.' per line followed
+// by a blank line, and write it out.
+static void render_grid(Frame *f, BitGrid *g) {
+  if (!f) {
+    return;
+  }
+  for (long r = 0; r < g->height; r++) {
+    framebits(f, bitrow(g, r), g->width, '#', '.');
+    framechar(f, '\n');
   }
-  dbgprintf("\n");
+  framechar(f, '\n');
+  flushframe(f);
 }
 
-static void fold_up(Grid *g, long line) {
-  assert(line > 0);
-  assert(line < g->height);
-  for (long mainline = line + 1, counterline = line - 1; mainline < g->height;
-       mainline++, counterline--) {
-    assert(counterline >= 0);
-    for (long c = 0; c < g->width; c++) {
-      char m = at(*g, c, mainline);
-      if (m == '#') {
-        at(*g, c, counterline) = m;
-      }
-    }
+// Render the dots of (s) as render_grid() does, if the sheet is small enough.
+static void render_dots(Frame *f, DotSheet const *s) {
+  if (!f || (double)s->width * s->height > DBGCELLS) {
+    return;
   }
-  g->height = line;
+  BitGrid g = xrenderdots(s);
+  render_grid(f, &g);
+  freebitgrid(g);
 }
 
-static void fold_left(Grid *g, int line) {
-  // First, you need to make character-by-character overwrites for '#'.
-  // Second, you need to resize the array horizontally, which is done by copying
-  // slices around.
-  assert(line > 0);
-  assert(line < g->width);
-  for (long mainline = line + 1, counterline = line - 1; mainline < g->width;
-       mainline++, counterline--) {
-    assert(counterline >= 0);
-    // Make character-by-character overwrites.
-    for (long r = 0; r < g->height; r++) {
-      char m = at(*g, mainline, r);
-      if (m == '#') {
-        at(*g, counterline, r) = m;
-      }
-    }
+// Parse "fold along x=5" into its axis and line. Like scanf(), return the
+// number of fields found.
+static int scanfold(StrView line, char *axis, long *along) {
+  static char const prefix[] = "fold along ";
+  if (!svprefix(line, prefix) || line.len < sizeof(prefix)) {
+    return 0;
   }
-  // For the grid layout it's kinda inflexible with the width.
-  // When you resize the width you also need to shuffle the data around.
-  // This is done by stitching together the isolated streaks of valid memory
-  // into a contiguous array. The old memory region and the new region
-  // may very well overlap in each step of the copying.
-  long old_row_size = g->width;
-  long new_row_size = g->width - line - 1;
-  for (long r = 1; r < g->height; r++) {
-    memmove(&g->xs[r * new_row_size], &g->xs[r * old_row_size], new_row_size);
+  line = svskip(line, sizeof(prefix) - 1);
+  *axis = line.p[0];
+  if (line.len < 3 || line.p[1] != '=') {
+    return 1;
   }
-  g->width = new_row_size;
+  *along = svtol(svskip(line, 2), 10, NULL);
+  return 2;
 }
 
-static long visible_dots(Grid *g) {
-  long count = 0;
-  FORRC(r, g->height, c, g->width) {
-    dbgprintf("visible_dots: access (r, c) = (%ld, %ld) offset=%ld\n", r, c,
-              &at(*g, c, r) - g->xs);
-    if (at(*g, c, r) == '#')
-      count++;
+// Close the input, which the pack owns if there is one.
+static void closesource(Input *in, Pack *pk) {
+  if (pk) {
+    closepack(pk);
+  } else {
+    closeinput(in);
   }
-  return count;
 }
 
-typedef struct {
-  long column, row;
-} Cursor;
-
-typedef struct {
-  Cursor *xs;
-  long len, cap, max_column, max_row;
-} Vector;
+// Read the next fold, either the next nonblank line of (in) or, given a
+// preparsed (axis, line) section, its row (*k)++. Return as scanfold() does,
+// or 0 when there are no more folds.
+static int nextfold(Input *in, PackSection const *folds, size_t *k, char *axis,
+                    long *along) {
+  if (folds) {
+    if (*k == folds->rows) {
+      return 0;
+    }
+    int32_t const *f = (int32_t const *)folds->data + 2 * (*k)++;
+    *axis = f[0];
+    *along = f[1];
+    return 2;
+  }
+  StrView line;
+  while (nextline(in, &line)) {
+    if (line.len) {
+      return scanfold(line, axis, along);
+    }
+  }
+  return 0;
+}
 
 int main(void) {
-  Grid g = {0};
-  Vector v = {0};
-  v.cap = 1;
-  v.xs = xcalloc(1, sizeof(Cursor));
+  Frame *dbg = xmkdbgframe();
+  DotSheet v = {0};
 
   // Read the lines, find out maximum column and row.
-  int scan;
-  long c, r;
-  for (scan = 0; (scan = scanf("%ld,%ld ", &c, &r)) == 2;) {
-    // Insert coords into v while expanding size as required.
-    // Update max column and row statistics.
-    if (v.len == v.cap) {
-      v.cap *= 2;
-      v.xs = xrealloc(v.xs, v.cap * sizeof(Cursor));
+  Input *in = xopeninput(NULL);
+  Pack *pk = NULL;
+  PackSection *folds = NULL;
+  size_t nfold = 0;
+  int scan = 0;
+  bool parsed = true;
+  if (ispack(in)) {
+    // Preparsed: (column, row) pairs, then (axis, line) folds.
+    pk = xloadpack(in);
+    PackSection *dots = xpacksection(pk, 0, PACK_I32);
+    folds = xpacksection(pk, 1, PACK_I32);
+    int32_t const *xy = dots->data;
+    for (size_t i = 0; i < dots->rows && parsed; i++) {
+      parsed = xinsdot(&v, xy[2 * i], xy[2 * i + 1]);
+    }
+  } else {
+    char const *p = in->buf, *end = in->buf + in->len;
+    long xy[BATCH];
+    size_t n;
+    while (parsed && (n = parselongs(&p, end, xy, BATCH))) {
+      // Only the last batch can be short, and must not end in half a pair.
+      parsed = n % 2 == 0;
+      for (size_t i = 0; i + 1 < n && parsed; i += 2) {
+        parsed = xinsdot(&v, xy[i], xy[i + 1]);
+      }
     }
-    v.xs[v.len].column = c;
-    v.xs[v.len].row = r;
-    v.len++;
-    v.max_column = tg_max(v.max_column, c);
-    v.max_row = tg_max(v.max_row, r);
+    // The folds follow the coordinates.
+    in->pos = p - in->buf;
+  }
+  if (!parsed) {
+    fprintf(stderr, "Abort while reading the dots: coordinates must come in "
+                    "pairs, and not be negative.\n");
+    freedots(&v);
+    closesource(in, pk);
+    freeframe(dbg);
+    return 1;
   }
-  v.cap = v.len;
-  v.xs = xrealloc(v.xs, v.len * sizeof(Cursor));
-
-  // Allocate the grid and fill it.
-  g.width = v.max_column + 1;
-  g.height = v.max_row + 1;
-  g.xs = xmalloc((size_t)g.width * (size_t)g.height);
-  FORRC(c, g.width, r, g.height) { at(g, c, r) = '.'; }
-  for (int i = 0; i < v.len; i++) {
-    Cursor co = v.xs[i];
-    dbgprintf("(c, r) = (%ld, %ld) offset=%ld\n", co.column, co.row,
-              &at(g, co.column, co.row) - g.xs);
-    at(g, co.column, co.row) = '#';
+  size_t points = v.len;
+  for (size_t i = 0; i < v.len; i++) {
+    dbgprintf("(c, r) = (%ld, %ld)\n", v.xs[i].column, v.xs[i].row);
   }
+  uniqdots(&v);
 
-  // Display the grid (debug)
-  dbg_grid(&g);
+  // Display the sheet (debug)
+  render_dots(dbg, &v);
 
   // Read the first fold.
   Fold fold;
@@ -151,7 +155,7 @@ int main(void) {
   dbgprintf("scanning for fold along\n");
   dbgflush(stdout);
   dbgflush(stderr);
-  scan = scanf("fold along %c=%ld ", &fold_c, &along);
+  scan = nextfold(in, folds, &nfold, &fold_c, &along);
   if (scan == 2) {
     switch (fold_c) {
     case 'y':
@@ -164,38 +168,39 @@ int main(void) {
       fprintf(stderr,
               "fold along direction is wrong: %c must be either 'x' or 'y'.\n",
               fold_c);
-      free(g.xs);
-      free(v.xs);
+      freedots(&v);
+      closesource(in, pk);
+      freeframe(dbg);
       return 1;
     }
   } else {
     fprintf(stderr, "Abort while reading fold information.\n");
-    free(g.xs);
-    free(v.xs);
+    freedots(&v);
+    closesource(in, pk);
+    freeframe(dbg);
     return 1;
   }
 
-  printf("%ld points read. Max column = %ld, max row = %ld\n", v.len,
-         v.max_column, v.max_row);
+  printf("%zu points read. Max column = %ld, max row = %ld\n", points,
+         v.width - 1, v.height - 1);
   printf("The fold: Fold %s, along %c=%ld\n", fold == FOLD_LEFT ? "LEFT" : "UP",
          fold_c, along);
 
-  // Vector goes out of scope here.
-  free(v.xs);
-  v = (Vector){0};
-
-  if (fold == FOLD_UP) {
-    dbgprintf("FOLD_UP initiated\n");
-    fold_up(&g, along);
-    dbg_grid(&g);
-  } else {
-    dbgprintf("FOLD_LEFT initiated\n");
-    fold_left(&g, along);
-    dbg_grid(&g);
+  dbgprintf("%s initiated\n", fold == FOLD_UP ? "FOLD_UP" : "FOLD_LEFT");
+  if (!(fold == FOLD_UP ? folddotsup(&v, along) : folddotsleft(&v, along))) {
+    fprintf(stderr, "fold along %c=%ld folds over more than it covers.\n",
+            fold_c, along);
+    freedots(&v);
+    closesource(in, pk);
+    freeframe(dbg);
+    return 1;
   }
+  render_dots(dbg, &v);
 
-  printf("After the first fold, %ld dots are visible.\n", visible_dots(&g));
+  printf("After the first fold, %zu dots are visible.\n", v.len);
 
-  free(g.xs);
+  freedots(&v);
+  closesource(in, pk);
+  freeframe(dbg);
   return 0;
 }
\ No newline at end of file
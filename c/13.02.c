@@ -1,158 +1,159 @@
 #include <assert.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "lib/bitset.h"
 #include "lib/dbgprint.h"
-#include "lib/iminmax.h"
+#include "lib/dots.h"
+#include "lib/input.h"
+#include "lib/pack.h"
+#include "lib/parseint.h"
+#include "lib/render.h"
 #include "lib/xalloc.h"
 
+// Coordinates parsed per call to parselongs(); even, so pairs stay whole.
+#define BATCH 4096
+
+// Sheets of more cells than this are too big to show for debugging.
+#define DBGCELLS (1L << 20)
+
 typedef enum {
   FOLD_LEFT,
   FOLD_UP,
 } Fold;
 
-typedef struct {
-  char *xs;
-  long width, height;
-} Grid;
-
-#define FORRC(r, r_max, c, c_max)                                              \
-  for (long r = 0; r < r_max; r++)                                             \
-    for (long c = 0; c < c_max; c++)
-
-#define at(g, c, r) ((g).xs[((c) + (r) * ((g).width))])
+// Render the sheet into (f), one row of '#' (dot) and '.' per line followed
+// by a blank line, and write it out.
+static void render_grid(Frame *f, BitGrid *g) {
+  if (!f) {
+    return;
+  }
+  for (long r = 0; r < g->height; r++) {
+    framebits(f, bitrow(g, r), g->width, '#', '.');
+    framechar(f, '\n');
+  }
+  framechar(f, '\n');
+  flushframe(f);
+}
 
-static void dbg_grid(Grid *g) {
-  long counter = 0;
-  FORRC(r, g->height, c, g->width) {
-    if (counter == (g->width - 1)) {
-      dbgprintf("%c\n", at(*g, c, r));
-      counter = 0;
-    } else {
-      dbgprintf("%c", at(*g, c, r));
-      counter++;
-    }
+// Render the dots of (s) as render_grid() does, if the sheet is small enough.
+static void render_dots(Frame *f, DotSheet const *s) {
+  if (!f || (double)s->width * s->height > DBGCELLS) {
+    return;
   }
-  dbgprintf("\n");
+  BitGrid g = xrenderdots(s);
+  render_grid(f, &g);
+  freebitgrid(g);
 }
 
-static void print_grid(Grid *g) {
-  long counter = 0;
-  FORRC(r, g->height, c, g->width) {
-    if (counter == (g->width - 1)) {
-      printf("%c\n", at(*g, c, r));
-      counter = 0;
-    } else {
-      printf("%c", at(*g, c, r));
-      counter++;
-    }
+// Parse "fold along x=5" into its axis and line. Like scanf(), return the
+// number of fields found.
+static int scanfold(StrView line, char *axis, long *along) {
+  static char const prefix[] = "fold along ";
+  if (!svprefix(line, prefix) || line.len < sizeof(prefix)) {
+    return 0;
+  }
+  line = svskip(line, sizeof(prefix) - 1);
+  *axis = line.p[0];
+  if (line.len < 3 || line.p[1] != '=') {
+    return 1;
   }
-  printf("\n");
+  *along = svtol(svskip(line, 2), 10, NULL);
+  return 2;
 }
 
-static void fold_up(Grid *g, long line) {
-  assert(line > 0);
-  assert(line < g->height);
-  for (long mainline = line + 1, counterline = line - 1; mainline < g->height;
-       mainline++, counterline--) {
-    assert(counterline >= 0);
-    for (long c = 0; c < g->width; c++) {
-      char m = at(*g, c, mainline);
-      if (m == '#') {
-        at(*g, c, counterline) = m;
-      }
-    }
+// Close the input, which the pack owns if there is one.
+static void closesource(Input *in, Pack *pk) {
+  if (pk) {
+    closepack(pk);
+  } else {
+    closeinput(in);
   }
-  g->height = line;
 }
 
-static void fold_left(Grid *g, int line) {
-  // First, you need to make character-by-character overwrites for '#'.
-  // Second, you need to resize the array horizontally, which is done by copying
-  // slices around.
-  assert(line > 0);
-  assert(line < g->width);
-  for (long mainline = line + 1, counterline = line - 1; mainline < g->width;
-       mainline++, counterline--) {
-    assert(counterline >= 0);
-    // Make character-by-character overwrites.
-    for (long r = 0; r < g->height; r++) {
-      char m = at(*g, mainline, r);
-      if (m == '#') {
-        at(*g, counterline, r) = m;
-      }
+// Read the next fold, either the next nonblank line of (in) or, given a
+// preparsed (axis, line) section, its row (*k)++. Return as scanfold() does,
+// or 0 when there are no more folds.
+static int nextfold(Input *in, PackSection const *folds, size_t *k, char *axis,
+                    long *along) {
+  if (folds) {
+    if (*k == folds->rows) {
+      return 0;
     }
+    int32_t const *f = (int32_t const *)folds->data + 2 * (*k)++;
+    *axis = f[0];
+    *along = f[1];
+    return 2;
   }
-  // For the grid layout it's kinda inflexible with the width.
-  // When you resize the width you also need to shuffle the data around.
-  // This is done by stitching together the isolated streaks of valid memory
-  // into a contiguous array. The old memory region and the new region
-  // may very well overlap in each step of the copying.
-  long old_row_size = g->width;
-  long new_row_size = g->width - line - 1;
-  for (long r = 1; r < g->height; r++) {
-    memmove(&g->xs[r * new_row_size], &g->xs[r * old_row_size], new_row_size);
+  StrView line;
+  while (nextline(in, &line)) {
+    if (line.len) {
+      return scanfold(line, axis, along);
+    }
   }
-  g->width = new_row_size;
+  return 0;
 }
 
-typedef struct {
-  long column, row;
-} Cursor;
-
-typedef struct {
-  Cursor *xs;
-  long len, cap, max_column, max_row;
-} Vector;
-
 int main(void) {
-  Grid g = {0};
-  Vector v = {0};
-  v.cap = 1;
-  v.xs = xcalloc(1, sizeof(Cursor));
+  BitGrid g = {0};
+  Frame *dbg = xmkdbgframe();
+  Frame *out = xmkframe(stdout);
+  DotSheet v = {0};
 
   // Read the lines, find out maximum column and row.
+  Input *in = xopeninput(NULL);
+  Pack *pk = NULL;
+  PackSection *folds = NULL;
+  size_t nfold = 0;
   int scan = 0;
-  Cursor co = {0};
-  while ((scan = scanf("%ld,%ld", &co.column, &co.row)) == 2) {
-    // Insert coords into v while expanding size as required.
-    // Update max column and row statistics.
-    if (v.len == v.cap) {
-      v.cap *= 2;
-      v.xs = xrealloc(v.xs, v.cap * sizeof(Cursor));
+  bool parsed = true;
+  if (ispack(in)) {
+    // Preparsed: (column, row) pairs, then (axis, line) folds.
+    pk = xloadpack(in);
+    PackSection *dots = xpacksection(pk, 0, PACK_I32);
+    folds = xpacksection(pk, 1, PACK_I32);
+    int32_t const *xy = dots->data;
+    for (size_t i = 0; i < dots->rows && parsed; i++) {
+      parsed = xinsdot(&v, xy[2 * i], xy[2 * i + 1]);
+    }
+  } else {
+    char const *p = in->buf, *end = in->buf + in->len;
+    long xy[BATCH];
+    size_t n;
+    while (parsed && (n = parselongs(&p, end, xy, BATCH))) {
+      // Only the last batch can be short, and must not end in half a pair.
+      parsed = n % 2 == 0;
+      for (size_t i = 0; i + 1 < n && parsed; i += 2) {
+        parsed = xinsdot(&v, xy[i], xy[i + 1]);
+      }
     }
-    v.xs[v.len++] = co;
-    v.max_column = tg_max(v.max_column, co.column);
-    v.max_row = tg_max(v.max_row, co.row);
+    // The folds follow the coordinates.
+    in->pos = p - in->buf;
   }
-  v.cap = v.len;
-  v.xs = xrealloc(v.xs, v.len * sizeof(Cursor));
-
-  // Allocate the grid and fill it.
-  g.width = v.max_column + 1;
-  g.height = v.max_row + 1;
-  g.xs = xmalloc((size_t)g.width * (size_t)g.height);
-  FORRC(c, g.width, r, g.height) { at(g, c, r) = '.'; }
-  for (int i = 0; i < v.len; i++) {
-    Cursor co = v.xs[i];
-    dbgprintf("(c, r) = (%ld, %ld) offset=%ld\n", co.column, co.row,
-              &at(g, co.column, co.row) - g.xs);
-    at(g, co.column, co.row) = '#';
+  if (!parsed) {
+    fprintf(stderr, "Abort while reading the dots: coordinates must come in "
+                    "pairs, and not be negative.\n");
+    goto error_exit;
   }
+  size_t points = v.len;
+  for (size_t i = 0; i < v.len; i++) {
+    dbgprintf("(c, r) = (%ld, %ld)\n", v.xs[i].column, v.xs[i].row);
+  }
+  uniqdots(&v);
 
-  // Display the grid (debug)
-  dbg_grid(&g);
-  printf("%ld points read. Max column = %ld, max row = %ld\n", v.len,
-         v.max_column, v.max_row);
+  // Display the sheet (debug)
+  render_dots(dbg, &v);
+  printf("%zu points read. Max column = %ld, max row = %ld\n", points,
+         v.width - 1, v.height - 1);
 
   // Read the folds.
   Fold fold;
   char fold_c;
   long along, fold_no = 0;
 
-  for (;;) {
-    scan = scanf("fold along %c=%ld ", &fold_c, &along);
+  while ((scan = nextfold(in, folds, &nfold, &fold_c, &along))) {
     if (scan == 2) {
       switch (fold_c) {
       case 'y':
@@ -178,31 +179,46 @@ int main(void) {
     printf("Fold #%ld: Fold %s, along %c=%ld\n", fold_no,
            fold == FOLD_LEFT ? "LEFT" : "UP", fold_c, along);
 
+    bool ok = false;
     switch (fold) {
     case FOLD_LEFT:
-      fold_left(&g, along);
+      ok = folddotsleft(&v, along);
       break;
     case FOLD_UP:
-      fold_up(&g, along);
+      ok = folddotsup(&v, along);
       break;
     default:
       // impossible
       assert(fold == FOLD_LEFT || fold == FOLD_UP);
     }
+    if (!ok) {
+      fprintf(stderr, "fold along %c=%ld folds over more than it covers.\n",
+              fold_c, along);
+      goto error_exit;
+    }
+    printf("After fold #%ld, %zu dots are visible.\n", fold_no, v.len);
 
     fold_no++;
 
-    dbg_grid(&g);
+    render_dots(dbg, &v);
   }
 
-  print_grid(&g);
+  // Only the folded sheet is laid out as a grid.
+  g = xrenderdots(&v);
+  render_grid(out, &g);
 
-  free(v.xs);
-  free(g.xs);
+  freedots(&v);
+  freebitgrid(g);
+  closesource(in, pk);
+  freeframe(out);
+  freeframe(dbg);
   return 0;
 
 error_exit:
-  free(v.xs);
-  free(g.xs);
+  freedots(&v);
+  freebitgrid(g);
+  closesource(in, pk);
+  freeframe(out);
+  freeframe(dbg);
   return 1;
 }
\ No newline at end of file
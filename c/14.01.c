@@ -9,6 +9,7 @@
 
 #include "lib/dbgprint.h"
 #include "lib/iminmax.h"
+#include "lib/input.h"
 #include "lib/xalloc.h"
 
 // Usage: ./14.01.[dbg|rel] [optional step-count] < input 2> trace > output
@@ -47,23 +48,28 @@ static int subcomp(void const *vpsub1, void const *vpsub2) {
 int main(int argc, char *argv[]) {
   int max_steps = argc == 2 ? atoi(argv[1]) : MAX_STEPS;
 
-  char *line = NULL;
-  size_t cap = 0;
-  ssize_t read = getline(&line, &cap, stdin);
-
-  if (read <= 0) {
+  Input *in = xopeninput(NULL);
+  StrView view;
+  if (!nextline(in, &view) || !view.len) {
     fprintf(stderr, "Error reading first line.\n");
-    free(line);
+    closeinput(in);
     return 1;
   }
-  line[read - 1] = '\0';
+  // The template is rewritten in place below, so it gets its own copy.
+  char *line = xsvdup(view);
 
   // Match rules are interpreted from the input at once and never change.
   MatchRules rules = {0};
   rules.cap = 1;
   rules.mps = xcalloc(rules.cap, sizeof(MatchPair));
-  while (scanf("%2s -> %c", rules.mps[rules.len].match_with,
-               &rules.mps[rules.len].replace_with) == 2) {
+  while (nextline(in, &view)) {
+    // "AB -> C"
+    if (view.len < 7 || !svprefix(svskip(view, 2), " -> ")) {
+      continue;
+    }
+    memcpy(rules.mps[rules.len].match_with, view.p, 2);
+    rules.mps[rules.len].match_with[2] = '\0';
+    rules.mps[rules.len].replace_with = view.p[6];
     rules.len++;
     if (rules.len == rules.cap) {
       rules.cap *= 2;
@@ -72,6 +78,7 @@ int main(int argc, char *argv[]) {
   }
   rules.mps = xrealloc(rules.mps, rules.len * sizeof(MatchPair));
   rules.cap = rules.len;
+  closeinput(in);
 
   char *work;
   for (int step = 1; step <= max_steps; step++) {
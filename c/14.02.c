@@ -4,6 +4,7 @@
 #include <stdlib.h>
 
 #include "lib/dbgprint.h"
+#include "lib/input.h"
 #include "lib/xalloc.h"
 
 // The match string, consisting of two 8-bit ASCII characters, is
@@ -67,26 +68,28 @@ int main(int argc, char *argv[]) {
   // >
   // > NN -> C
   // > HC -> B
-  char *line = NULL, c1, c2, cr;
-  size_t cap = 0;
-  ssize_t read = getline(&line, &cap, stdin);
-  if (read < 0) {
+  char c1, c2, cr;
+  Input *in = xopeninput(NULL);
+  StrView line, rule;
+  if (!nextline(in, &line)) {
     fprintf(stderr, "Read line error (EOF)\n");
     abort();
   }
-  line[read - 1] = '\0';
-  for (int i = 0; i < read - 1; i++) {
-    c_counts[(int)line[i]]++;
+  for (size_t i = 0; i < line.len; i++) {
+    c_counts[(int)line.p[i]]++;
   }
-  for (int i = 0; i < read - 2; i++) {
-    pat_counts[COALESCE(line[i], line[i + 1])]++;
+  for (size_t i = 0; i + 1 < line.len; i++) {
+    pat_counts[COALESCE(line.p[i], line.p[i + 1])]++;
   }
-  while (scanf(" %c%c -> %c ", &c1, &c2, &cr) == 3) {
-    rewrites[COALESCE(c1, c2)] = cr;
+  while (nextline(in, &rule)) {
+    // "AB -> C"
+    if (rule.len >= 7 && svprefix(svskip(rule, 2), " -> ")) {
+      rewrites[COALESCE(rule.p[0], rule.p[1])] = rule.p[6];
+    }
   }
 
   // DEBUG ONLY
-  dbgprintf("Line: %s\n", line);
+  dbgprintf("Line: %.*s\n", PRIsv(line));
   dbg_pat_ccnts();
   dbgprintf("Rules found:\n");
   for (int pat = 0; pat < USHRT_MAX; pat++) {
@@ -97,7 +100,7 @@ int main(int argc, char *argv[]) {
   }
 
   // End interpreting first line and the rewrite rules for the L-system.
-  free(line);
+  closeinput(in);
 
   // Evolve the L-system from the previous value and the rewrite rules.
   for (int step = 1; step <= max_steps; step++) {
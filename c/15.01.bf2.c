@@ -1,4 +1,11 @@
-// Bellman-Ford implementation with grid
+// Shortest path through the risk grid. The solvers live in lib/sssp; pick one
+// with -s (Bellman-Ford by default). With -t 5, solve the map made of 5 by 5
+// tiles of the input (part 2) without ever storing it. The path runs from -f
+// to -g (by default, from the top-left to the bottom-right corner).
+//
+// With -u, read batches of risk updates from a file, one "row col risk" line
+// per base cell, batches separated by blank lines. After each, repair the
+// solution rather than solving again, and print the cost once more.
 
 #include <assert.h>
 #include <inttypes.h>
@@ -6,219 +13,212 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "lib/dbgprint.h"
+#include "lib/grid.h"
+#include "lib/input.h"
+#include "lib/sssp.h"
 #include "lib/xalloc.h"
 
-typedef struct _grid_t {
-  int *xs, rows, columns;
-} Grid;
-
-// These macros caused me a lot of headaches so I'm going to replace them
-// with a better impl.
-
-#define at(g, r, c) ((g).xs[(r) * (g).columns + (c)])
-#define i_at(g, r, c) ((r) * (g).columns + (c))
-#define up(g, r, c) ((g).xs[(r - 1) * (g).columns + (c)])
-#define i_up(g, r, c) ((r - 1) * (g).columns + (c))
-#define down(g, r, c) ((g).xs[(r + 1) * (g).columns + (c)])
-#define i_down(g, r, c) ((r + 1) * (g).columns + (c))
-#define left(g, r, c) ((g).xs[(r) * (g).columns + (c - 1)])
-#define i_left(g, r, c) ((r) * (g).columns + (c - 1))
-#define right(g, r, c) ((g).xs[(r) * (g).columns + (c + 1)])
-#define i_right(g, r, c) ((r) * (g).columns + (c + 1))
-#define good(g, r, c)                                                          \
-  ((r) >= 0 && (r) < (g).rows && (c) >= 0 && (c) < (g).columns)
-#define for_rc(g, r, c)                                                        \
-  for (int r = 0; r < (g).rows; r++)                                           \
-    for (int c = 0; c < (g).columns; c++)
-
-// The reason why this structure isn't used everywhere is because it was added
-// right in the middle of the algorithm impl.
-
-typedef struct _cursor_t {
-  int row, column;
-} Cursor;
-
-#define cursor(r, c)                                                           \
-  (Cursor) { .row = (r), .column = (c) }
-
-#define PRIcursor(co) (co).row, (co).column
-
-// Though the problem doesn't require one to trace the shortest path, thus
-// eliminating a direct need for `pred`, I need it nevertheless for debugging
-// purposes.
-typedef struct _solution_t {
-  int *cost;
-  Cursor *pred;
-  long n;
-} Solution;
-
-void delete_solution(Solution s) {
-  free(s.cost);
-  free(s.pred);
+// Threads (0: one per online CPU) and bucket width for delta-stepping.
+static int nthreads = 0, bucketwidth = MAXRISK;
+
+static Solution deltastep(RiskMap const *m, int start_r, int start_c) {
+  return delta_grid(m, start_r, start_c, nthreads, bucketwidth);
 }
 
-// Show bellman-ford solution at end.
-void show_grid_status(Grid g, Solution s) {
-  int r = g.rows - 1;
-  int c = g.columns - 1;
-
-  while (s.cost[i_at(g, r, c)]) {
-    Cursor co = s.pred[i_at(g, r, c)];
-    dbgprintf("(0, 0) -> (%d, %d) [%d], cost is %d, pred (%d, %d)\n", r, c,
-              at(g, r, c), s.cost[i_at(g, r, c)], PRIcursor(co));
-    r = co.row;
-    c = co.column;
+// A solver settles every cell; a query stops once it knows the goal.
+typedef Solution (*Solver)(RiskMap const *m, int start_r, int start_c);
+typedef Solution (*Query)(RiskMap const *m, int start_r, int start_c,
+                          int goal_r, int goal_c);
+
+static struct {
+  char const *name;
+  Solver solve;
+  Query query;
+} const solvers[] = {
+    {"bellman-ford", bellman_ford_grid, NULL},
+    {"dial", dial_grid, NULL},
+    {"sweep", sweep_grid, NULL},
+    {"delta", deltastep, NULL},
+    {"astar", NULL, astar_grid},
+    {"bidir", NULL, bidir_grid},
+};
+
+#define NSOLVERS (sizeof(solvers) / sizeof(solvers[0]))
+
+Grid read_problem() {
+  Grid g = xloaddigitgrid(xopeninput(NULL), 1, WALL);
+  dbgprintf("The grid (width = %d, height = %d)\n", g.width, g.height);
+  for (int r = 0; r < g.height; r++) {
+    for (int c = 0; c < g.width; c++) {
+      dbgprintf("%d", *gridat(&g, r, c));
+    }
+    dbgprintf("\n");
   }
+  return g;
 }
 
-// By saturated addition, (x + y) < z is correctly evaluated.
-int saddcmp(int x, int y, int z) {
-  unsigned ux = x, uy = y;
-  if (ux + uy > INT_MAX) {
-    return 0;
-  } else {
-    return x + y < z;
+static void usage(char const *argv0) {
+  fprintf(stderr,
+          "Usage: %s [-s solver] [-t tiles] [-f row,col] [-g row,col] "
+          "[-j threads] [-d delta] [-u updates] < input\nSolvers:",
+          argv0);
+  for (size_t k = 0; k < NSOLVERS; k++) {
+    fprintf(stderr, " %s", solvers[k].name);
   }
+  fprintf(stderr, "\n");
 }
 
-Solution bellman_ford_grid(Grid const *g, int start_r, int start_c) {
-  long n_vertices = (long)g->columns * (long)g->rows;
-
-  Solution s = {.n = n_vertices,
-                .cost = xmalloc(sizeof(int) * n_vertices),
-                .pred = xmalloc(sizeof(Cursor) * n_vertices)};
-
-  for (int i = 0; i < n_vertices; i++) {
-    s.cost[i] = INT_MAX;
-    s.pred[i] = (Cursor){.row = -1, .column = -1};
+static bool blank(StrView v) {
+  for (size_t k = 0; k < v.len; k++) {
+    if (v.p[k] != ' ' && v.p[k] != '\t' && v.p[k] != '\r') {
+      return false;
+    }
   }
+  return true;
+}
 
-  s.cost[i_at(*g, start_r, start_c)] = 0;
-
-  for (long repeat = 0; repeat < n_vertices; repeat++) {
-    long n_updates = 0;
-
-    for_rc(*g, r, c) {
-      Cursor co = cursor(r, c);
-      int here_cost = s.cost[i_at(*g, r, c)];
-
-      // Up
-      if (good(*g, r - 1, c)) {
-        int update = up(*g, r, c);
-        if (saddcmp(here_cost, update, s.cost[i_up(*g, r, c)])) {
-          dbgprintf("Up from (%d, %d), assign %d (from %d)\n", PRIcursor(co),
-                    here_cost + update, s.cost[i_up(*g, r, c)]);
-          n_updates++;
-          s.cost[i_up(*g, r, c)] = here_cost + update;
-          s.pred[i_up(*g, r, c)] = cursor(r, c);
-        }
-      }
-      // Down
-      if (good(*g, r + 1, c)) {
-        int update = down(*g, r, c);
-        if (saddcmp(here_cost, update, s.cost[i_down(*g, r, c)])) {
-          dbgprintf("Down from (%d, %d), assign %d (from %d)\n", PRIcursor(co),
-                    here_cost + update, s.cost[i_down(*g, r, c)]);
-          n_updates++;
-          s.cost[i_down(*g, r, c)] = here_cost + update;
-          s.pred[i_down(*g, r, c)] = cursor(r, c);
-        }
-      }
-      // Left
-      if (good(*g, r, c - 1)) {
-        int update = left(*g, r, c);
-        if (saddcmp(here_cost, update, s.cost[i_left(*g, r, c)])) {
-          dbgprintf("Left from (%d, %d), assign %d (from %d)\n", PRIcursor(co),
-                    here_cost + update, s.cost[i_left(*g, r, c)]
-
-          );
-          n_updates++;
-          s.cost[i_left(*g, r, c)] = here_cost + update;
-          s.pred[i_left(*g, r, c)] = cursor(r, c);
-        }
-      }
-      // Right
-      if (good(*g, r, c + 1)) {
-        int update = right(*g, r, c);
-        if (saddcmp(here_cost, update, s.cost[i_right(*g, r, c)])) {
-          dbgprintf("Right from (%d, %d), assign %d (from %d)\n", PRIcursor(co),
-                    here_cost + update, s.cost[i_right(*g, r, c)]);
-          n_updates++;
-          s.cost[i_right(*g, r, c)] = here_cost + update;
-          s.pred[i_right(*g, r, c)] = cursor(r, c);
-        }
+// Read the next batch of updates into (*u), which grows as needed. Return
+// false at the end of the input. Exit on a malformed line.
+static bool readbatch(Input *in, RiskUpdate **u, size_t *n, size_t *cap) {
+  StrView line;
+  *n = 0;
+  while (nextline(in, &line)) {
+    if (blank(line)) {
+      if (*n) {
+        break;
       }
+      continue;
     }
-
-    if (n_updates) {
-      dbgprintf("%ld updates were made.\n", n_updates);
-    } else {
-      dbgprintf("No further updates made in step %ld\n", repeat);
-      break;
+    char *text = xsvdup(line);
+    RiskUpdate x;
+    int end = 0;
+    if (sscanf(text, "%d %d %d %n", &x.row, &x.column, &x.risk, &end) != 3 ||
+        text[end]) {
+      fprintf(stderr, "Bad update: %s\n", text);
+      exit(1);
     }
-
-    dbgprintf("Bellman-Ford Generation %ld\n", repeat);
-    show_grid_status(*g, s);
-    dbgprintf("Costs\n");
-    for_rc(*g, r, c) {
-      dbgprintf("(%d, %d) cost = %d, from (%d, %d)\n", r, c,
-                s.cost[i_at(*g, r, c)], PRIcursor(s.pred[i_at(*g, r, c)]));
+    free(text);
+    if (*n == *cap) {
+      *cap = *cap ? *cap * 2 : 16;
+      *u = xrealloc(*u, *cap * sizeof(RiskUpdate));
     }
+    (*u)[(*n)++] = x;
   }
-
-  return s;
+  return *n;
 }
 
-Grid read_problem() {
-  Grid g = {0};
-  char *line = NULL;
-  size_t cap = 0;
-  // used for grid allocation
-  size_t row_cap = 0;
-  while (getline(&line, &cap, stdin) > 0) {
-    if (g.columns == 0) {
-      g.columns = strlen(line) - 1;
-      g.rows = 1;
-      g.xs = xcalloc(g.columns, sizeof(int));
-      for (int i = 0; i < g.columns; i++) {
-        g.xs[i] = line[i] - '0';
+int main(int argc, char *argv[]) {
+  int solver = 0;
+  int tiles = 1;
+  Cursor from = cursor(0, 0), to = cursor(-1, -1);
+  bool hasto = false;
+  int opt;
+  char const *updates = NULL;
+  while ((opt = getopt(argc, argv, "s:t:f:g:j:d:u:")) != -1) {
+    switch (opt) {
+    case 's':
+      solver = -1;
+      for (size_t k = 0; k < NSOLVERS; k++) {
+        if (strcmp(optarg, solvers[k].name) == 0) {
+          solver = k;
+        }
+      }
+      if (solver < 0) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'f':
+      if (!parsecell(optarg, &from)) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'g':
+      if (!parsecell(optarg, &to)) {
+        usage(argv[0]);
+        return 1;
       }
-      row_cap = 1;
-    } else {
-      if (g.rows == row_cap) {
-        row_cap *= 2;
-        g.xs =
-            xrealloc(g.xs, (size_t)row_cap * (size_t)g.columns * sizeof(int));
+      hasto = true;
+      break;
+    case 'j':
+      nthreads = atoi(optarg);
+      break;
+    case 'd':
+      bucketwidth = atoi(optarg);
+      if (bucketwidth < 1) {
+        usage(argv[0]);
+        return 1;
       }
-      for (int i = 0; i < g.columns; i++) {
-        g.xs[i + g.rows * g.columns] = line[i] - '0';
+      break;
+    case 'u':
+      updates = optarg;
+      break;
+    case 't':
+      tiles = atoi(optarg);
+      if (tiles < 1) {
+        usage(argv[0]);
+        return 1;
       }
-      g.rows++;
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
     }
   }
-  free(line);
-  dbgprintf("The grid (width = %d, height = %d)\n", g.columns, g.rows);
-  for (int r = 0; r < g.rows; r++) {
-    for (int c = 0; c < g.columns; c++) {
-      dbgprintf("%d", at(g, r, c));
-    }
-    dbgprintf("\n");
+
+  // A query knows too little of the map to repair.
+  if (updates && solvers[solver].query) {
+    fprintf(stderr, "%s: -u needs a solver, not a query\n", argv[0]);
+    return 1;
   }
-  return g;
-}
 
-int main(void) {
   Grid g = read_problem();
+  RiskMap m = xmkriskmap(&g, tiles);
+  Grid const *shape = &m.shape;
 
-  Solution s = bellman_ford_grid(&g, 0, 0);
+  if (!hasto) {
+    to = cursor(shape->height - 1, shape->width - 1);
+  }
+  if (!inmap(shape, from) || !inmap(shape, to)) {
+    fprintf(stderr, "The map is %d by %d cells\n", shape->height,
+            shape->width);
+    return 1;
+  }
+
+  Solution s = solvers[solver].query
+                   ? solvers[solver].query(&m, PRIcursor(from), PRIcursor(to))
+                   : solvers[solver].solve(&m, PRIcursor(from));
 
   // Only shown at debug compilation
-  show_grid_status(g, s);
+  PathWalk w;
+  if (walkpath(&w, &s, PRIcursor(to))) {
+    do {
+      dbgprintf("(%d, %d) [%d], cost is %u\n", PRIcursor(w.at),
+                riskat(&m, w.i, PRIcursor(w.at)), getcost(&s, w.i));
+    } while (stepback(&w));
+  }
 
-  printf("Cost %d.\n", s.cost[i_at(g, g.rows - 1, g.columns - 1)]);
+  printf("Cost %u.\n", getcost(&s, gridindex(shape, PRIcursor(to))));
+
+  if (updates) {
+    Input *in = xopeninput(updates);
+    RiskUpdate *u = NULL;
+    size_t n, cap = 0;
+    while (readbatch(in, &u, &n, &cap)) {
+      RiskChanges ch = xsetrisks(&m, u, n);
+      repair_grid(&m, &s, &ch);
+      freeriskchanges(ch);
+      printf("Cost %u.\n", getcost(&s, gridindex(shape, PRIcursor(to))));
+    }
+    free(u);
+    closeinput(in);
+  }
 
   delete_solution(s);
-  free(g.xs);
+  freeriskmap(m);
+  freegrid(g);
 }
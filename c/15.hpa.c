@@ -0,0 +1,116 @@
+// Answer path queries on a risk map too big to search whole, through the
+// hierarchy of lib/hpa. The map is loaded once from the file named on the
+// command line (text or pack); queries come one per line on standard input:
+//
+//   r0 c0 r1 c1        the cost of a path from (r0, c0) to (r1, c1)
+//   path r0 c0 r1 c1   the cost, then the cells of the path
+//
+// Each answer is one line, flushed at once. -c sets the size of a cluster,
+// -e the spacing of the nodes along its borders, and -t tiles the map as in
+// part 2. With -x, the abstract graph is loaded from that file if it was made
+// for this map with these sizes, and built and saved there otherwise.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lib/dbgprint.h"
+#include "lib/grid.h"
+#include "lib/hpa.h"
+#include "lib/input.h"
+#include "lib/sssp.h"
+
+static void usage(char const *argv0) {
+  fprintf(stderr,
+          "Usage: %s [-c size] [-e spacing] [-t tiles] [-x file] map "
+          "< queries\n",
+          argv0);
+}
+
+// Run one query line. Return false if it is malformed.
+static bool query(Hpa *h, char const *line) {
+  Grid const *shape = &h->m->shape;
+  Cursor from, to;
+  int n = 0;
+  bool path = false;
+  if (sscanf(line, " path%n", &n) == 0 && n) {
+    path = true;
+    line += n;
+  }
+  n = 0;
+  if (sscanf(line, "%d %d %d %d %n", &from.row, &from.column, &to.row,
+             &to.column, &n) != 4 ||
+      line[n] || !inmap(shape, from) || !inmap(shape, to)) {
+    return false;
+  }
+
+  Cursor *cells;
+  uint32_t cost;
+  long len = xhpapath(h, from, to, &cells, &cost);
+  printf("%u", cost);
+  for (long k = 0; path && k < len; k++) {
+    printf(" %d,%d", PRIcursor(cells[k]));
+  }
+  printf("\n");
+  free(cells);
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  int size = 32, spacing = 8, tiles = 1;
+  char const *saved = NULL;
+  int opt;
+  while ((opt = getopt(argc, argv, "c:e:t:x:")) != -1) {
+    switch (opt) {
+    case 'c':
+      size = atoi(optarg);
+      break;
+    case 'e':
+      spacing = atoi(optarg);
+      break;
+    case 't':
+      tiles = atoi(optarg);
+      break;
+    case 'x':
+      saved = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (optind != argc - 1 || size < 1 || spacing < 1 || tiles < 1) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  Grid g = xloaddigitgrid(xopeninput(argv[optind]), 1, WALL);
+  RiskMap m = xmkriskmap(&g, tiles);
+  Hpa h;
+  if (!saved || !xloadhpa(&h, &m, saved, size, spacing)) {
+    h = xmkhpa(&m, size, spacing);
+    if (saved) {
+      xsavehpa(&h, saved);
+    }
+  }
+  dbgprintf("%ld nodes in %d by %d clusters\n", h.nnodes, h.crows, h.ccols);
+
+  char *line = NULL;
+  size_t cap = 0;
+  ssize_t len;
+  while ((len = getline(&line, &cap, stdin)) != -1) {
+    if (len && line[len - 1] == '\n') {
+      line[len - 1] = '\0';
+    }
+    if (!query(&h, line)) {
+      printf("error: %s\n", line);
+    }
+    fflush(stdout);
+  }
+  free(line);
+
+  freehpa(&h);
+  freeriskmap(m);
+  freegrid(g);
+}
@@ -0,0 +1,84 @@
+// The cheapest path through a risk map that need not fit in memory (see
+// lib/ooc). The map comes from the file named on the command line (text or
+// pack), or standard input, and is laid out on disk in tiles of -T cells
+// square, at most -C of which are in memory at once; -o keeps the tile file
+// at that path rather than in an unnamed temporary. The path runs from -f to
+// -g (by default, from the top-left to the bottom-right corner). After the
+// cost comes a line of I/O statistics.
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "lib/ooc.h"
+#include "lib/sssp.h"
+
+static void usage(char const *argv0) {
+  fprintf(stderr,
+          "Usage: %s [-T tile] [-C cache] [-o store] [-f row,col] "
+          "[-g row,col] [map]\n",
+          argv0);
+}
+
+int main(int argc, char *argv[]) {
+  int tile = 256, cache = 64;
+  char const *store = NULL;
+  Cursor from = cursor(0, 0), to = cursor(-1, -1);
+  bool hasto = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "T:C:o:f:g:")) != -1) {
+    switch (opt) {
+    case 'T':
+      tile = atoi(optarg);
+      break;
+    case 'C':
+      cache = atoi(optarg);
+      break;
+    case 'o':
+      store = optarg;
+      break;
+    case 'f':
+      if (!parsecell(optarg, &from)) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'g':
+      if (!parsecell(optarg, &to)) {
+        usage(argv[0]);
+        return 1;
+      }
+      hasto = true;
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (optind < argc - 1 || tile < 1 || cache < 1) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  TileStore *ts =
+      xmktilestore(optind < argc ? argv[optind] : NULL, store, tile, cache);
+  int width, height;
+  tilemapsize(ts, &width, &height);
+  if (!hasto) {
+    to = cursor(height - 1, width - 1);
+  }
+  Grid shape = gridshape(width, height, 0);
+  if (!inmap(&shape, from) || !inmap(&shape, to)) {
+    fprintf(stderr, "The map is %d by %d cells\n", height, width);
+    return 1;
+  }
+
+  printf("Cost %u.\n", xsolvetiles(ts, PRIcursor(from), PRIcursor(to)));
+  TileStats st = tilestats(ts);
+  printf("Tiles: %ld passes, %ld hits, %ld loads, %ld writebacks; "
+         "%" PRIu64 " bytes read, %" PRIu64 " written\n",
+         st.passes, st.hits, st.loads, st.writebacks, st.bytesread,
+         st.byteswritten);
+  closetilestore(ts);
+}
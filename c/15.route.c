@@ -0,0 +1,116 @@
+// Answer cheapest-path queries on one risk map, loaded once from the file
+// named on the command line (text or pack). Queries come one per line on
+// standard input:
+//
+//   r0 c0 r1 c1        the cost from (r0, c0) to (r1, c1)
+//   path r0 c0 r1 c1   the cost, then the cells of the path
+//   stats              queries, cache hits, and trees built so far
+//
+// Each answer is one line, flushed at once. -c sets how many shortest-path
+// trees to keep (see lib/route.h); -t tiles the map as in part 2.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lib/grid.h"
+#include "lib/input.h"
+#include "lib/route.h"
+#include "lib/sssp.h"
+
+static void usage(char const *argv0) {
+  fprintf(stderr, "Usage: %s [-c trees] [-t tiles] map < queries\n", argv0);
+}
+
+// Run one query line. Return false if it is malformed.
+static bool query(Router *rt, char const *line) {
+  Grid const *shape = &rt->m->shape;
+  Cursor from, to;
+  int n = 0;
+  bool path = false;
+  if (sscanf(line, " stats %n", &n) == 0 && n && !line[n]) {
+    printf("queries %ld hits %ld trees %ld\n", rt->queries, rt->hits,
+           rt->solves);
+    return true;
+  }
+  n = 0;
+  if (sscanf(line, " path%n", &n) == 0 && n) {
+    path = true;
+    line += n;
+  }
+  n = 0;
+  if (sscanf(line, "%d %d %d %d %n", &from.row, &from.column, &to.row,
+             &to.column, &n) != 4 ||
+      line[n] || !inmap(shape, from) || !inmap(shape, to)) {
+    return false;
+  }
+
+  if (!path) {
+    uint32_t cost = routecost(rt, from, to);
+    if (cost == UNREACHED) {
+      printf("unreachable\n");
+    } else {
+      printf("%u\n", cost);
+    }
+    return true;
+  }
+  Cursor *cells;
+  uint32_t cost;
+  long len = xroutepath(rt, from, to, &cells, &cost);
+  if (!len) {
+    printf("unreachable\n");
+  } else {
+    printf("%u", cost);
+    for (long k = 0; k < len; k++) {
+      printf(" %d,%d", PRIcursor(cells[k]));
+    }
+    printf("\n");
+  }
+  free(cells);
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  int capacity = 8, tiles = 1;
+  int opt;
+  while ((opt = getopt(argc, argv, "c:t:")) != -1) {
+    switch (opt) {
+    case 'c':
+      capacity = atoi(optarg);
+      break;
+    case 't':
+      tiles = atoi(optarg);
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (optind != argc - 1 || capacity < 0 || tiles < 1) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  Grid g = xloaddigitgrid(xopeninput(argv[optind]), 1, WALL);
+  RiskMap m = xmkriskmap(&g, tiles);
+  Router rt = xmkrouter(&m, capacity);
+
+  char *line = NULL;
+  size_t cap = 0;
+  ssize_t len;
+  while ((len = getline(&line, &cap, stdin)) != -1) {
+    if (len && line[len - 1] == '\n') {
+      line[len - 1] = '\0';
+    }
+    if (!query(&rt, line)) {
+      printf("error: %s\n", line);
+    }
+    fflush(stdout);
+  }
+  free(line);
+
+  freerouter(&rt);
+  freeriskmap(m);
+  freegrid(g);
+}
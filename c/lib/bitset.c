@@ -0,0 +1,208 @@
+#include "xalloc.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitset.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BITSET_X86 1
+#endif
+
+uint64_t revword(uint64_t x) {
+  x = __builtin_bswap64(x);
+  x = ((x >> 4) & 0x0f0f0f0f0f0f0f0full) | ((x & 0x0f0f0f0f0f0f0f0full) << 4);
+  x = ((x >> 2) & 0x3333333333333333ull) | ((x & 0x3333333333333333ull) << 2);
+  x = ((x >> 1) & 0x5555555555555555ull) | ((x & 0x5555555555555555ull) << 1);
+  return x;
+}
+
+static size_t popcountwords_scalar(uint64_t const *ws, size_t n) {
+  size_t count = 0;
+  for (size_t i = 0; i < n; i++) {
+    count += popcount64(ws[i]);
+  }
+  return count;
+}
+
+#ifdef BITSET_X86
+__attribute__((target("popcnt"))) static size_t
+popcountwords_popcnt(uint64_t const *ws, size_t n) {
+  size_t count = 0;
+  for (size_t i = 0; i < n; i++) {
+    count += __builtin_popcountll(ws[i]);
+  }
+  return count;
+}
+#endif
+
+size_t popcountwords(uint64_t const *ws, size_t n) {
+#ifdef BITSET_X86
+  if (__builtin_cpu_supports("popcnt")) {
+    return popcountwords_popcnt(ws, n);
+  }
+#endif
+  return popcountwords_scalar(ws, n);
+}
+
+// Define the AVX2, SSE2 and scalar versions of a bulk word operation, and the
+// dispatcher (name) that picks one of them at run time.
+#ifdef BITSET_X86
+#define BULKOP(name, scalar_expr, sse_fn, avx_fn)                              \
+  __attribute__((target("avx2"))) static void name##_avx2(                     \
+      uint64_t *restrict dst, uint64_t const *restrict src, size_t n) {        \
+    size_t i = 0;                                                              \
+    for (; i + 4 <= n; i += 4) {                                               \
+      __m256i d = _mm256_loadu_si256((__m256i const *)(dst + i));              \
+      __m256i s = _mm256_loadu_si256((__m256i const *)(src + i));              \
+      _mm256_storeu_si256((__m256i *)(dst + i), avx_fn);                       \
+    }                                                                          \
+    for (; i < n; i++) {                                                       \
+      uint64_t d = dst[i], s = src[i];                                         \
+      dst[i] = scalar_expr;                                                    \
+    }                                                                          \
+  }                                                                            \
+  __attribute__((target("sse2"))) static void name##_sse2(                     \
+      uint64_t *restrict dst, uint64_t const *restrict src, size_t n) {        \
+    size_t i = 0;                                                              \
+    for (; i + 2 <= n; i += 2) {                                               \
+      __m128i d = _mm_loadu_si128((__m128i const *)(dst + i));                 \
+      __m128i s = _mm_loadu_si128((__m128i const *)(src + i));                 \
+      _mm_storeu_si128((__m128i *)(dst + i), sse_fn);                          \
+    }                                                                          \
+    for (; i < n; i++) {                                                       \
+      uint64_t d = dst[i], s = src[i];                                         \
+      dst[i] = scalar_expr;                                                    \
+    }                                                                          \
+  }                                                                            \
+  void name(uint64_t *restrict dst, uint64_t const *restrict src, size_t n) {  \
+    if (__builtin_cpu_supports("avx2")) {                                      \
+      name##_avx2(dst, src, n);                                                \
+    } else {                                                                   \
+      name##_sse2(dst, src, n);                                                \
+    }                                                                          \
+  }
+#else
+#define BULKOP(name, scalar_expr, sse_fn, avx_fn)                              \
+  void name(uint64_t *restrict dst, uint64_t const *restrict src, size_t n) {  \
+    for (size_t i = 0; i < n; i++) {                                           \
+      uint64_t d = dst[i], s = src[i];                                         \
+      dst[i] = scalar_expr;                                                    \
+    }                                                                          \
+  }
+#endif
+
+BULKOP(orwords, d | s, _mm_or_si128(d, s), _mm256_or_si256(d, s))
+BULKOP(andwords, d & s, _mm_and_si128(d, s), _mm256_and_si256(d, s))
+BULKOP(xorwords, d ^ s, _mm_xor_si128(d, s), _mm256_xor_si256(d, s))
+// Note the operand order of andnot: the intrinsics complement the first.
+BULKOP(andnotwords, d & ~s, _mm_andnot_si128(s, d), _mm256_andnot_si256(s, d))
+
+// The 64 bits [s, s + 64) of ws. Bits below 0 read as zero. Bit s + 63 must
+// exist.
+static uint64_t loadbits(uint64_t const *ws, ptrdiff_t s) {
+  if (s < 0) {
+    return ws[0] << -s;
+  }
+  size_t w = s / WORDBITS, b = s % WORDBITS;
+  if (!b) {
+    return ws[w];
+  }
+  return (ws[w] >> b) | (ws[w + 1] << (WORDBITS - b));
+}
+
+void revbits(uint64_t *restrict dst, uint64_t const *restrict src, size_t off,
+             size_t n) {
+  for (size_t k = 0; k * WORDBITS < n; k++) {
+    ptrdiff_t hi = (ptrdiff_t)(off + n - k * WORDBITS);
+    uint64_t x = revword(loadbits(src, hi - WORDBITS));
+    if ((k + 1) * WORDBITS > n) {
+      // Last, partial word: drop the bits that came from below (off).
+      x &= tailmask(n);
+    }
+    dst[k] = x;
+  }
+}
+
+void orbitsat(uint64_t *restrict dst, size_t off, uint64_t const *restrict src,
+              size_t n) {
+  size_t b = off % WORDBITS;
+  uint64_t *d = dst + off / WORDBITS;
+  for (size_t k = 0; k * WORDBITS < n; k++) {
+    uint64_t x = src[k];
+    if ((k + 1) * WORDBITS > n) {
+      x &= tailmask(n);
+    }
+    d[k] |= x << b;
+    // Only touch the next word if something spills into it; the spilled bits
+    // are below off + n, so that word exists.
+    uint64_t spill;
+    if (b && (spill = x >> (WORDBITS - b))) {
+      d[k + 1] |= spill;
+    }
+  }
+}
+
+BitSet *xmkbitset(size_t nbits) {
+  BitSet *b = xmalloc(sizeof(BitSet));
+  b->len = nbits;
+  b->nwords = NWORDS(nbits);
+  b->ws = xcalloc(b->nwords ? b->nwords : 1, sizeof(uint64_t));
+  return b;
+}
+
+void freebitset(BitSet *b) {
+  free(b->ws);
+  free(b);
+}
+
+size_t popcountbitset(BitSet const *b) {
+  return popcountwords(b->ws, b->nwords);
+}
+
+BitGrid xmkbitgrid(long width, long height) {
+  BitGrid g = {.width = width, .height = height, .stride = NWORDS(width)};
+  size_t n = g.stride * (size_t)height;
+  g.ws = xcalloc(n ? n : 1, sizeof(uint64_t));
+  return g;
+}
+
+void freebitgrid(BitGrid g) { free(g.ws); }
+
+size_t popcountbitgrid(BitGrid const *g) {
+  // Rows are contiguous and their tails are zero, so count them in one go.
+  return popcountwords(g->ws, g->stride * (size_t)g->height);
+}
+
+bool foldbitgridup(BitGrid *g, long line) {
+  long n = g->height - line - 1;
+  if (line <= 0 || line >= g->height || n > line) {
+    return false;
+  }
+  for (long k = 1; k <= n; k++) {
+    orwords(bitrow(g, line - k), bitrow(g, line + k), g->stride);
+  }
+  g->height = line;
+  return true;
+}
+
+bool foldbitgridleft(BitGrid *g, long line) {
+  if (line <= 0 || line >= g->width || g->width - line - 1 > line) {
+    return false;
+  }
+  size_t n = g->width - line - 1;
+  size_t keep = NWORDS(line);
+  uint64_t *tmp = xcalloc(NWORDS(n) + 1, sizeof(uint64_t));
+  for (long r = 0; r < g->height; r++) {
+    uint64_t *row = bitrow(g, r);
+    // Column line + 1 + j lands on column line - 1 - j.
+    revbits(tmp, row, line + 1, n);
+    orbitsat(row, line - n, tmp, n);
+    // Drop the folded-away columns so the row tail stays zero.
+    row[keep - 1] &= tailmask(line);
+    memset(row + keep, 0, (g->stride - keep) * sizeof(uint64_t));
+  }
+  free(tmp);
+  g->width = line;
+  return true;
+}
@@ -0,0 +1,137 @@
+#ifndef BITSET_H
+#define BITSET_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Number of bits in a storage word.
+#define WORDBITS 64
+
+// Number of words needed to store (n) bits.
+#define NWORDS(n) (((n) + WORDBITS - 1) / WORDBITS)
+
+typedef struct {
+  uint64_t *ws;
+  size_t len;    // number of bits
+  size_t nwords; // number of words in ws
+} BitSet;
+
+// A 2D bit matrix. Each row starts at a word boundary; bits past width in the
+// last word of a row are kept at zero by every routine below.
+typedef struct {
+  uint64_t *ws;
+  long width, height;
+  size_t stride; // words per row
+} BitGrid;
+
+// A column view: the same bit (mask) in every (stride)-th word from (w).
+typedef struct {
+  uint64_t *w;
+  uint64_t mask;
+  size_t stride;
+} BitColumn;
+
+static inline bool getbit(uint64_t const *ws, size_t i) {
+  return (ws[i / WORDBITS] >> (i % WORDBITS)) & 1;
+}
+
+static inline void setbit(uint64_t *ws, size_t i) {
+  ws[i / WORDBITS] |= (uint64_t)1 << (i % WORDBITS);
+}
+
+static inline void clrbit(uint64_t *ws, size_t i) {
+  ws[i / WORDBITS] &= ~((uint64_t)1 << (i % WORDBITS));
+}
+
+// Mask of the bits in use in the last word of an (n)-bit run.
+static inline uint64_t tailmask(size_t n) {
+  return n % WORDBITS ? ((uint64_t)1 << (n % WORDBITS)) - 1 : ~(uint64_t)0;
+}
+
+// Count bits in a single word.
+static inline int popcount64(uint64_t x) { return __builtin_popcountll(x); }
+
+// Reverse the bits of a single word (bit 0 <-> bit 63).
+uint64_t revword(uint64_t x);
+
+// Count the bits set in (n) words. Uses the POPCNT instruction when the CPU
+// has it.
+size_t popcountwords(uint64_t const *ws, size_t n);
+
+// Bulk word operations over (n) words: dst = dst OP src. These use AVX2 when
+// the CPU has it, else SSE2, else a scalar loop.
+void orwords(uint64_t *restrict dst, uint64_t const *restrict src, size_t n);
+void andwords(uint64_t *restrict dst, uint64_t const *restrict src, size_t n);
+void xorwords(uint64_t *restrict dst, uint64_t const *restrict src, size_t n);
+// dst = dst & ~src.
+void andnotwords(uint64_t *restrict dst, uint64_t const *restrict src,
+                 size_t n);
+
+// Write into dst bits [0, n) the bits [off, off + n) of src in reverse order,
+// so that dst bit 0 is src bit off + n - 1. Bits of dst past n are cleared
+// within the last word written.
+void revbits(uint64_t *restrict dst, uint64_t const *restrict src, size_t off,
+             size_t n);
+
+// OR the bits [0, n) of src into dst bits [off, off + n).
+void orbitsat(uint64_t *restrict dst, size_t off, uint64_t const *restrict src,
+              size_t n);
+
+// Allocate a zeroed bitset of (nbits) bits or abort.
+BitSet *xmkbitset(size_t nbits);
+
+// Frees a bitset.
+void freebitset(BitSet *b);
+
+// Count the bits set in a bitset.
+size_t popcountbitset(BitSet const *b);
+
+// Allocate a zeroed bit grid or abort.
+BitGrid xmkbitgrid(long width, long height);
+
+// Frees a bit grid's storage.
+void freebitgrid(BitGrid g);
+
+// Row view: the words of row (r).
+static inline uint64_t *bitrow(BitGrid const *g, long r) {
+  return g->ws + (size_t)r * g->stride;
+}
+
+// Column view of column (c).
+static inline BitColumn bitcolumn(BitGrid const *g, long c) {
+  return (BitColumn){.w = g->ws + c / WORDBITS,
+                     .mask = (uint64_t)1 << (c % WORDBITS),
+                     .stride = g->stride};
+}
+
+static inline bool getcolbit(BitColumn col, long r) {
+  return (col.w[(size_t)r * col.stride] & col.mask) != 0;
+}
+
+static inline void setcolbit(BitColumn col, long r) {
+  col.w[(size_t)r * col.stride] |= col.mask;
+}
+
+static inline bool getgridbit(BitGrid const *g, long c, long r) {
+  return getbit(bitrow(g, r), c);
+}
+
+static inline void setgridbit(BitGrid *g, long c, long r) {
+  setbit(bitrow(g, r), c);
+}
+
+// Count the bits set in a bit grid.
+size_t popcountbitgrid(BitGrid const *g);
+
+// Fold the grid upwards along row (line): row line + k is ORed into row
+// line - k, and the height becomes (line). Return false, leaving the grid as
+// it was, unless (line) is inside the grid and the lower half is no taller
+// than the upper half.
+bool foldbitgridup(BitGrid *g, long line);
+
+// Fold the grid leftwards along column (line): column line + k is ORed into
+// column line - k, and the width becomes (line). Return false, leaving the
+// grid as it was, unless (line) is inside the grid and the right half is no
+// wider than the left half.
+bool foldbitgridleft(BitGrid *g, long line);
+#endif
@@ -0,0 +1,79 @@
+#include "xalloc.h"
+#include <stdlib.h>
+
+#include "dots.h"
+
+bool xinsdot(DotSheet *s, long column, long row) {
+  if (column < 0 || row < 0) {
+    return false;
+  }
+  if (s->len == s->cap) {
+    s->cap = s->cap ? 2 * s->cap : 64;
+    s->xs = xrealloc(s->xs, s->cap * sizeof(Dot));
+  }
+  s->xs[s->len++] = (Dot){.column = column, .row = row};
+  s->width = column >= s->width ? column + 1 : s->width;
+  s->height = row >= s->height ? row + 1 : s->height;
+  return true;
+}
+
+static int cmpdots(void const *a, void const *b) {
+  Dot const *x = a, *y = b;
+  if (x->row != y->row) {
+    return x->row < y->row ? -1 : 1;
+  }
+  return (x->column > y->column) - (x->column < y->column);
+}
+
+void uniqdots(DotSheet *s) {
+  if (!s->len) {
+    return;
+  }
+  qsort(s->xs, s->len, sizeof(Dot), cmpdots);
+  size_t n = 1;
+  for (size_t i = 1; i < s->len; i++) {
+    if (cmpdots(&s->xs[i], &s->xs[n - 1])) {
+      s->xs[n++] = s->xs[i];
+    }
+  }
+  s->len = n;
+}
+
+// Fold the columns of the dots along (line) if (left), else their rows.
+static bool folddots(DotSheet *s, long line, bool left) {
+  long *size = left ? &s->width : &s->height;
+  if (line < 0 || *size - line - 1 > line) {
+    return false;
+  }
+  size_t n = 0;
+  for (size_t i = 0; i < s->len; i++) {
+    Dot d = s->xs[i];
+    long *x = left ? &d.column : &d.row;
+    if (*x == line) {
+      continue;
+    }
+    *x = *x > line ? 2 * line - *x : *x;
+    s->xs[n++] = d;
+  }
+  s->len = n;
+  *size = *size < line ? *size : line;
+  uniqdots(s);
+  return true;
+}
+
+bool folddotsleft(DotSheet *s, long line) { return folddots(s, line, true); }
+
+bool folddotsup(DotSheet *s, long line) { return folddots(s, line, false); }
+
+BitGrid xrenderdots(DotSheet const *s) {
+  BitGrid g = xmkbitgrid(s->width, s->height);
+  for (size_t i = 0; i < s->len; i++) {
+    setgridbit(&g, s->xs[i].column, s->xs[i].row);
+  }
+  return g;
+}
+
+void freedots(DotSheet *s) {
+  free(s->xs);
+  *s = (DotSheet){0};
+}
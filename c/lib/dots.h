@@ -0,0 +1,43 @@
+#ifndef DOTS_H
+#define DOTS_H
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "bitset.h"
+
+typedef struct {
+  long column, row;
+} Dot;
+
+// The transparent sheet of day 13 as a list of its dots rather than a grid
+// of cells, so that it takes memory for the dots alone however far apart
+// they lie. A fold moves the dots past the line onto their mirror images and
+// then sorts them, by row then column, to drop those that land together.
+typedef struct {
+  Dot *xs;
+  size_t len, cap;
+  long width, height; // of the sheet: past the last dot, or the last fold
+} DotSheet;
+
+// Add a dot at (column, row), widening the sheet to take it if needed. The
+// sheet may then hold it twice until uniqdots(). Return false, adding
+// nothing, if either is negative. Abort on failure.
+bool xinsdot(DotSheet *s, long column, long row);
+
+// Sort the dots and drop repeats.
+void uniqdots(DotSheet *s);
+
+// Fold the sheet leftwards along column (line): column line + k goes onto
+// column line - k, those on the line go, and the width becomes at most
+// (line). Return false, leaving the sheet as it was, if the right part is
+// wider than the left.
+bool folddotsleft(DotSheet *s, long line);
+
+// Fold the sheet upwards along row (line), as folddotsleft() does columns.
+bool folddotsup(DotSheet *s, long line);
+
+// The sheet as a grid with a bit set for each dot. Abort on failure.
+BitGrid xrenderdots(DotSheet const *s);
+
+void freedots(DotSheet *s);
+#endif
@@ -0,0 +1,127 @@
+#include "xalloc.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "grid.h"
+#include "pack.h"
+
+// Round (n) up to a multiple of GRIDALIGN.
+static size_t alignup(size_t n) {
+  return (n + GRIDALIGN - 1) / GRIDALIGN * GRIDALIGN;
+}
+
+static void *xalignedalloc(size_t n) {
+  void *p = aligned_alloc(GRIDALIGN, alignup(n ? n : 1));
+  if (!p) {
+    perror("xmkgrid: aligned_alloc");
+    abort();
+  }
+  return p;
+}
+
+Grid gridshape(int width, int height, int halo) {
+  return (Grid){.width = width,
+                .height = height,
+                .halo = halo,
+                .stride = alignup(width + 2 * halo)};
+}
+
+Grid xmkgrid(int width, int height, int halo, signed char sentinel) {
+  Grid g = gridshape(width, height, halo);
+  g.base = xalignedalloc(gridsize(&g));
+  memset(g.base, 0, gridsize(&g));
+  g.cells = g.base - gridlo(&g);
+  fillhalo(&g, sentinel);
+  return g;
+}
+
+void freegrid(Grid g) { free(g.base); }
+
+void fillhalo(Grid *g, signed char sentinel) {
+  int rows = g->height + 2 * g->halo;
+  for (int k = 0; k < rows; k++) {
+    signed char *row = g->base + k * g->stride;
+    if (k < g->halo || k >= g->halo + g->height) {
+      memset(row, sentinel, g->stride);
+    } else {
+      memset(row, sentinel, g->halo);
+      memset(row + g->halo + g->width, sentinel,
+             g->stride - g->halo - g->width);
+    }
+  }
+}
+
+Grid xloaddigitgrid(Input *in, int halo, signed char sentinel) {
+  if (ispack(in)) {
+    Pack *pk = xloadpack(in);
+    PackSection *s = xpacksection(pk, 0, PACK_U8);
+    if (s->rows > INT_MAX || s->cols > INT_MAX) {
+      fprintf(stderr, "xloaddigitgrid: %zu by %zu cells is too many\n",
+              s->rows, s->cols);
+      abort();
+    }
+    Grid g = xmkgrid(s->cols, s->rows, halo, sentinel);
+    for (int r = 0; r < g.height; r++) {
+      unsigned char const *row = (unsigned char const *)s->data + r * s->cols;
+      for (int c = 0; c < g.width; c++) {
+        if (row[c] > 9) {
+          fprintf(stderr, "xloaddigitgrid: row %d, column %d holds %d, "
+                          "not a digit\n",
+                  r + 1, c + 1, row[c]);
+          abort();
+        }
+      }
+      memcpy(gridat(&g, r, 0), row, s->cols);
+    }
+    closepack(pk);
+    return g;
+  }
+
+  // Size the grid first, then fill it.
+  size_t start = in->pos;
+  StrView line;
+  int width = 0, height = 0;
+  while (nextline(in, &line) && line.len) {
+    if (!height) {
+      width = line.len;
+    } else if (line.len != (size_t)width) {
+      fprintf(stderr, "xloaddigitgrid: row %d has %zu columns, not %d\n",
+              height + 1, line.len, width);
+      abort();
+    }
+    height++;
+  }
+  in->pos = start;
+  Grid g = xmkgrid(width, height, halo, sentinel);
+  for (int r = 0; r < height; r++) {
+    nextline(in, &line);
+    signed char *row = gridat(&g, r, 0);
+    for (int c = 0; c < width; c++) {
+      row[c] = line.p[c] - '0';
+    }
+  }
+  closeinput(in);
+  return g;
+}
+
+Stencil gridn4(Grid const *g) {
+  ptrdiff_t s = g->stride;
+  return (Stencil){.d = {-s, s, -1, 1}, .n = 4};
+}
+
+Stencil gridn8(Grid const *g) {
+  ptrdiff_t s = g->stride;
+  return (Stencil){.d = {-s - 1, -s, -s + 1, -1, 1, s - 1, s, s + 1}, .n = 8};
+}
+
+void *xmkgridlayer(Grid const *g, size_t size) {
+  char *base = xalignedalloc(gridsize(g) * size);
+  memset(base, 0, gridsize(g) * size);
+  return base - gridlo(g) * (ptrdiff_t)size;
+}
+
+void freegridlayer(Grid const *g, void *layer, size_t size) {
+  free((char *)layer + gridlo(g) * (ptrdiff_t)size);
+}
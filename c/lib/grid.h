@@ -0,0 +1,92 @@
+#ifndef GRID_H
+#define GRID_H
+#include <stddef.h>
+
+#include "input.h"
+
+// Rows are padded to a multiple of this many bytes (a cache line).
+#define GRIDALIGN 64
+
+// A 2D grid of small integers surrounded on every side by (halo) cells of a
+// sentinel value, so that a stencil applied to any interior cell reads the
+// sentinel where it would have gone out of bounds, and needs no checks.
+//
+// Cells are addressed by a signed index from cell (0, 0), so halo cells have
+// negative indices or columns. Every row, halo included, starts on a
+// GRIDALIGN-byte boundary.
+typedef struct {
+  signed char *cells; // cell (0, 0)
+  signed char *base;  // the allocation
+  int width, height, halo;
+  ptrdiff_t stride; // cells per row, halo and padding included
+} Grid;
+
+// Offsets from an index to its neighbors.
+typedef struct {
+  ptrdiff_t d[8];
+  int n;
+} Stencil;
+
+// A (width) by (height) grid of zeros inside a halo of (sentinel). Abort on
+// failure.
+Grid xmkgrid(int width, int height, int halo, signed char sentinel);
+
+void freegrid(Grid g);
+
+// The layout xmkgrid() would give, without any cells. Enough to address a
+// grid that is never stored and to make layers for it.
+Grid gridshape(int width, int height, int halo);
+
+// Set every halo cell to (sentinel).
+void fillhalo(Grid *g, signed char sentinel);
+
+// Load a grid of digits (as values 0 to 9, not characters) from (in): either
+// lines of text, up to an empty line, or a pack (see pack.h) with a U8
+// section, and close it. Abort if the rows are ragged.
+Grid xloaddigitgrid(Input *in, int halo, signed char sentinel);
+
+static inline ptrdiff_t gridindex(Grid const *g, int r, int c) {
+  return r * g->stride + c;
+}
+
+static inline signed char *gridat(Grid const *g, int r, int c) {
+  return g->cells + gridindex(g, r, c);
+}
+
+// Indices into the whole allocation, halo and padding included, run from
+// gridlo() for gridsize() cells.
+static inline ptrdiff_t gridlo(Grid const *g) {
+  return -g->halo * (g->stride + 1);
+}
+
+static inline size_t gridsize(Grid const *g) {
+  return (size_t)(g->height + 2 * g->halo) * g->stride;
+}
+
+// The row and the column of an index.
+static inline int gridrow(Grid const *g, ptrdiff_t i) {
+  return (int)((i - gridlo(g)) / g->stride) - g->halo;
+}
+
+static inline int gridcol(Grid const *g, ptrdiff_t i) {
+  return (int)((i - gridlo(g)) % g->stride) - g->halo;
+}
+
+// The 4-neighborhood, in the order up, down, left, right. Needs a halo of 1.
+Stencil gridn4(Grid const *g);
+
+// The 8-neighborhood, row by row from the upper left. Needs a halo of 1.
+Stencil gridn8(Grid const *g);
+
+// Visit each index (j) next to the index (i) under the stencil (st).
+#define FORSTENCIL(j, i, st)                                                   \
+  for (ptrdiff_t j##_k = 0, j = 0;                                             \
+       j##_k < (st).n && ((j) = (i) + (st).d[j##_k], 1); j##_k++)
+
+// An array of (size)-byte elements laid out like (g), halo included: the
+// element for index i of the grid is element i of the returned pointer. It is
+// zeroed. Abort on failure.
+void *xmkgridlayer(Grid const *g, size_t size);
+
+void freegridlayer(Grid const *g, void *layer, size_t size);
+#endif
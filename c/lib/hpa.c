@@ -0,0 +1,592 @@
+#include "xalloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "dbgprint.h"
+#include "hpa.h"
+
+// The first section of a saved graph: these, then the two halves of the
+// fingerprint of the map.
+enum { HPAVERSION = 1, HEADERLEN = 8 };
+
+// A growing list of cell indices.
+typedef struct {
+  ptrdiff_t *xs;
+  long len, cap;
+} Indices;
+
+static void pushindex(Indices *v, ptrdiff_t i) {
+  if (v->len == v->cap) {
+    v->cap = v->cap ? v->cap * 2 : 64;
+    v->xs = xrealloc(v->xs, v->cap * sizeof(ptrdiff_t));
+  }
+  v->xs[v->len++] = i;
+}
+
+// A cluster on its own: a copy of its risks inside a halo of 0, and costs
+// laid out like them, whose halo stays at 0 so that relaxing into it never
+// succeeds (as in new_solution()).
+typedef struct {
+  int r0, c0; // where it starts in the whole map
+  Grid g;
+  uint32_t *cost;
+  Indices q[MAXRISK + 1];
+} Window;
+
+static int clusterof(Hpa const *h, int r, int c) {
+  return r / h->size * h->ccols + c / h->size;
+}
+
+// Where cluster (cl) starts, and its size: clusters on the last row or
+// column may be cut short.
+static void clusterbox(Hpa const *h, int cl, int *r0, int *c0, int *height,
+                       int *width) {
+  Grid const *shape = &h->m->shape;
+  *r0 = cl / h->ccols * h->size;
+  *c0 = cl % h->ccols * h->size;
+  *height = shape->height - *r0 < h->size ? shape->height - *r0 : h->size;
+  *width = shape->width - *c0 < h->size ? shape->width - *c0 : h->size;
+}
+
+// Copy the risks of cluster (cl) into (*w).
+static void openwindow(Hpa const *h, int cl, Window *w) {
+  Grid const *shape = &h->m->shape;
+  int height, width;
+  *w = (Window){0};
+  clusterbox(h, cl, &w->r0, &w->c0, &height, &width);
+  w->g = xmkgrid(width, height, 1, 0);
+  for_rc(w->g, r, c) {
+    int mr = w->r0 + r, mc = w->c0 + c;
+    *gridat(&w->g, r, c) = riskat(h->m, gridindex(shape, mr, mc), mr, mc);
+  }
+  w->cost = xmkgridlayer(&w->g, sizeof(uint32_t));
+}
+
+static void closewindow(Window *w) {
+  for (int k = 0; k <= MAXRISK; k++) {
+    free(w->q[k].xs);
+  }
+  freegridlayer(&w->g, w->cost, sizeof(uint32_t));
+  freegrid(w->g);
+}
+
+// Cost every cell of the window from (r, c) of the whole map, with Dial's
+// algorithm (see dial_grid()).
+static void windowdial(Window *w, int r, int c) {
+  Grid const *g = &w->g;
+  Stencil n4 = gridn4(g);
+  for (int y = 0; y < g->height; y++) {
+    memset(&w->cost[gridindex(g, y, 0)], 0xff, g->width * sizeof(uint32_t));
+  }
+  ptrdiff_t start = gridindex(g, r - w->r0, c - w->c0);
+  w->cost[start] = 0;
+  pushindex(&w->q[0], start);
+  long pending = 1;
+  for (uint32_t d = 0; pending; d++) {
+    Indices *b = &w->q[d % (MAXRISK + 1)];
+    for (long k = 0; k < b->len; k++) {
+      ptrdiff_t i = b->xs[k];
+      pending--;
+      if (w->cost[i] != d) {
+        continue;
+      }
+      for (int n = 0; n < n4.n; n++) {
+        ptrdiff_t j = i + n4.d[n];
+        uint32_t x = d + g->cells[j];
+        if (x < w->cost[j]) {
+          w->cost[j] = x;
+          pushindex(&w->q[x % (MAXRISK + 1)], j);
+          pending++;
+        }
+      }
+    }
+    b->len = 0;
+  }
+}
+
+// The cost of (r, c) of the whole map after windowdial().
+static uint32_t windowcost(Window const *w, int r, int c) {
+  return w->cost[gridindex(&w->g, r - w->r0, c - w->c0)];
+}
+
+// Where the nodes go along a border of (len) cells: every (spacing) cells
+// and at the far end. Return how many.
+static int stops(int len, int spacing, int *ps) {
+  int n = 0;
+  for (int p = 0; p < len - 1; p += spacing) {
+    ps[n++] = p;
+  }
+  ps[n++] = len - 1;
+  return n;
+}
+
+Hpa xmkhpa(RiskMap const *m, int size, int spacing) {
+  Grid const *shape = &m->shape;
+  Hpa h = {.m = m, .size = size, .spacing = spacing};
+  h.crows = (shape->height + size - 1) / size;
+  h.ccols = (shape->width + size - 1) / size;
+  int nclusters = h.crows * h.ccols;
+  int *ps = xcalloc(size + 1, sizeof(int));
+
+  // Nodes come in twins, one on each side of a border, at the same stop. So
+  // the twin of a node is the node of the neighbor on the opposite border
+  // with the same rank: count the nodes on every border first.
+  int *border = xcalloc(4 * (size_t)nclusters + 1, sizeof(int));
+  int32_t *first = xcalloc(nclusters + 1, sizeof(int32_t));
+  for (int cl = 0; cl < nclusters; cl++) {
+    int cr = cl / h.ccols, cc = cl % h.ccols, r0, c0, height, width;
+    clusterbox(&h, cl, &r0, &c0, &height, &width);
+    bool open[4] = {cr > 0, cr < h.crows - 1, cc > 0, cc < h.ccols - 1};
+    first[cl + 1] = first[cl];
+    for (int d = 0; d < 4; d++) {
+      border[4 * cl + d] = first[cl + 1];
+      first[cl + 1] += open[d] ? stops(d < 2 ? width : height, spacing, ps) : 0;
+    }
+  }
+  h.nnodes = first[nclusters];
+
+  int32_t *nodes = xcalloc(3 * h.nnodes + 1, sizeof(int32_t));
+  size_t *costoff = xcalloc(nclusters + 1, sizeof(size_t));
+  for (int cl = 0; cl < nclusters; cl++) {
+    int r0, c0, height, width;
+    clusterbox(&h, cl, &r0, &c0, &height, &width);
+    size_t k = first[cl + 1] - first[cl];
+    costoff[cl + 1] = costoff[cl] + k * k;
+    for (int d = 0; d < 4; d++) {
+      int end = d == 3 ? first[cl + 1] : border[4 * cl + d + 1];
+      int n = end - border[4 * cl + d];
+      if (!n) {
+        continue;
+      }
+      stops(d < 2 ? width : height, spacing, ps);
+      int neighbor = cl + (d < 2 ? n4rows[d] * h.ccols : n4cols[d]);
+      for (int q = 0; q < n; q++) {
+        int32_t *p = &nodes[3 * (border[4 * cl + d] + q)];
+        p[0] = d == 0 ? r0 : d == 1 ? r0 + height - 1 : r0 + ps[q];
+        p[1] = d == 2 ? c0 : d == 3 ? c0 + width - 1 : c0 + ps[q];
+        p[2] = border[4 * neighbor + oppositedir(d)] + q;
+      }
+    }
+  }
+  free(border);
+  free(ps);
+
+  h.nodes = nodes;
+  uint32_t *cost = xcalloc(costoff[nclusters] + 1, sizeof(uint32_t));
+  for (int cl = 0; cl < nclusters; cl++) {
+    Window w;
+    openwindow(&h, cl, &w);
+    long k = first[cl + 1] - first[cl];
+    for (long a = 0; a < k; a++) {
+      int32_t const *p = &nodes[3 * (first[cl] + a)];
+      windowdial(&w, p[0], p[1]);
+      for (long b = 0; b < k; b++) {
+        p = &nodes[3 * (first[cl] + b)];
+        cost[costoff[cl] + a * k + b] = windowcost(&w, p[0], p[1]);
+      }
+    }
+    closewindow(&w);
+  }
+  dbgprintf("HPA: %d by %d clusters, %ld nodes, %zu intra-cluster costs\n",
+            h.crows, h.ccols, h.nnodes, costoff[nclusters]);
+
+  h.first = first;
+  h.cost = cost;
+  h.costoff = costoff;
+  return h;
+}
+
+// FNV-1a over the size of the map, its tiling and its risks.
+static uint64_t fingerprint(RiskMap const *m) {
+  Grid const *base = m->base;
+  uint64_t x = 14695981039346656037u;
+  int const dims[] = {base->width, base->height, m->tiles};
+  for (size_t k = 0; k < sizeof(dims) / sizeof(dims[0]); k++) {
+    x = (x ^ (uint64_t)dims[k]) * 1099511628211u;
+  }
+  for_rc(*base, r, c) {
+    x = (x ^ (unsigned char)*gridat(base, r, c)) * 1099511628211u;
+  }
+  return x;
+}
+
+static void header(Hpa const *h, int32_t *head) {
+  uint64_t x = fingerprint(h->m);
+  int32_t const fields[HEADERLEN] = {
+      HPAVERSION, h->m->shape.width, h->m->shape.height, h->size, h->spacing,
+      h->m->tiles, (int32_t)(uint32_t)x, (int32_t)(uint32_t)(x >> 32)};
+  memcpy(head, fields, sizeof(fields));
+}
+
+// Whether the nodes of (h) and their clusters, as loaded, hang together: each
+// cluster's nodes follow the last's, lie in it, and have twins that exist.
+static bool validhpa(Hpa const *h) {
+  int nclusters = h->crows * h->ccols;
+  if (h->first[0] != 0 || h->first[nclusters] != h->nnodes) {
+    return false;
+  }
+  for (int cl = 0; cl < nclusters; cl++) {
+    if (h->first[cl + 1] < h->first[cl]) {
+      return false;
+    }
+    for (long a = h->first[cl]; a < h->first[cl + 1]; a++) {
+      int32_t const *p = &h->nodes[3 * a];
+      if (p[0] < 0 || p[0] >= h->m->shape.height || p[1] < 0 ||
+          p[1] >= h->m->shape.width || clusterof(h, p[0], p[1]) != cl ||
+          p[2] < 0 || p[2] >= h->nnodes) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool xloadhpa(Hpa *h, RiskMap const *m, char const *path, int size,
+              int spacing) {
+  if (access(path, R_OK) != 0) {
+    return false;
+  }
+  Pack *pk = xloadpack(xopeninput(path));
+  Hpa t = {.m = m, .size = size, .spacing = spacing, .pk = pk};
+  int32_t want[HEADERLEN];
+  header(&t, want);
+  PackSection *head = xpacksection(pk, 0, PACK_I32);
+  if (head->rows * head->cols != HEADERLEN ||
+      memcmp(head->data, want, sizeof(want)) != 0) {
+    dbgprintf("HPA: %s was made for another map\n", path);
+    closepack(pk);
+    return false;
+  }
+  t.crows = (m->shape.height + size - 1) / size;
+  t.ccols = (m->shape.width + size - 1) / size;
+  int nclusters = t.crows * t.ccols;
+
+  PackSection *nodes = xpacksection(pk, 1, PACK_I32);
+  PackSection *first = xpacksection(pk, 2, PACK_I32);
+  PackSection *cost = xpacksection(pk, 3, PACK_I32);
+  t.nnodes = nodes->rows;
+  t.nodes = nodes->data;
+  t.first = first->data;
+  t.cost = cost->data;
+  if (nodes->cols != 3 || first->rows != (size_t)nclusters + 1 ||
+      !validhpa(&t)) {
+    fprintf(stderr, "xloadhpa: %s is malformed\n", path);
+    abort();
+  }
+  t.costoff = xcalloc(nclusters + 1, sizeof(size_t));
+  for (int cl = 0; cl < nclusters; cl++) {
+    size_t k = t.first[cl + 1] - t.first[cl];
+    t.costoff[cl + 1] = t.costoff[cl] + k * k;
+  }
+  if (t.costoff[nclusters] != cost->rows * cost->cols) {
+    fprintf(stderr, "xloadhpa: %s is malformed\n", path);
+    abort();
+  }
+  *h = t;
+  return true;
+}
+
+void xsavehpa(Hpa const *h, char const *path) {
+  int nclusters = h->crows * h->ccols;
+  int32_t head[HEADERLEN];
+  header(h, head);
+  PackSection const sections[] = {
+      {PACK_I32, 1, HEADERLEN, head},
+      {PACK_I32, h->nnodes, 3, (void *)h->nodes},
+      {PACK_I32, nclusters + 1, 1, (void *)h->first},
+      {PACK_I32, h->costoff[nclusters], 1, (void *)h->cost},
+  };
+
+  // Write beside the file, then rename over it, so that a save cut short
+  // leaves no half a graph for the next run to load.
+  size_t len = strlen(path);
+  char *tmp = xmalloc(len + 5);
+  memcpy(tmp, path, len);
+  memcpy(tmp + len, ".tmp", 5);
+  FILE *f = fopen(tmp, "wb");
+  if (!f) {
+    perror(tmp);
+    abort();
+  }
+  xwritepack(f, sections, sizeof(sections) / sizeof(sections[0]));
+  if (fflush(f) || fsync(fileno(f)) || fclose(f) || rename(tmp, path)) {
+    perror(tmp);
+    abort();
+  }
+  free(tmp);
+}
+
+void freehpa(Hpa *h) {
+  if (h->pk) {
+    closepack(h->pk);
+  } else {
+    free((void *)h->nodes);
+    free((void *)h->first);
+    free((void *)h->cost);
+  }
+  free(h->costoff);
+  free(h->dist);
+  free(h->parent);
+  free(h->stamp);
+  free(h->slot);
+}
+
+// A binary min-heap of nodes keyed by cost so far plus a lower bound on the
+// cost left. Abstract edges cost up to hundreds, too many for a bucket ring.
+typedef struct {
+  uint32_t key;
+  int32_t node;
+} HeapItem;
+
+typedef struct {
+  HeapItem *xs;
+  size_t len, cap;
+} Heap;
+
+static void pushheap(Heap *q, uint32_t key, int32_t node) {
+  if (q->len == q->cap) {
+    q->cap = q->cap ? q->cap * 2 : 64;
+    q->xs = xrealloc(q->xs, q->cap * sizeof(HeapItem));
+  }
+  size_t k = q->len++;
+  for (; k && q->xs[(k - 1) / 2].key > key; k = (k - 1) / 2) {
+    q->xs[k] = q->xs[(k - 1) / 2];
+  }
+  q->xs[k] = (HeapItem){key, node};
+}
+
+static HeapItem popheap(Heap *q) {
+  HeapItem top = q->xs[0], last = q->xs[--q->len];
+  size_t k = 0;
+  for (size_t child; (child = 2 * k + 1) < q->len; k = child) {
+    if (child + 1 < q->len && q->xs[child + 1].key < q->xs[child].key) {
+      child++;
+    }
+    if (q->xs[child].key >= last.key) {
+      break;
+    }
+    q->xs[k] = q->xs[child];
+  }
+  q->xs[k] = last;
+  return top;
+}
+
+// The cost of node (a) so far in the current query.
+static uint32_t nodedist(Hpa const *h, long a) {
+  return h->stamp[a] == h->query ? h->dist[a] : UNREACHED;
+}
+
+static void setdist(Hpa *h, long a, uint32_t d, int32_t parent) {
+  h->stamp[a] = h->query;
+  h->dist[a] = d;
+  h->parent[a] = parent;
+}
+
+// A lower bound on the cost from node (a) to (to).
+static uint32_t bound(Hpa const *h, long a, Cursor to) {
+  int32_t const *p = &h->nodes[3 * a];
+  return (uint32_t)h->m->minrisk *
+         (abs(p[0] - to.row) + abs(p[1] - to.column));
+}
+
+// A growing list of cells.
+typedef struct {
+  Cursor *xs;
+  long len, cap;
+} Cells;
+
+static void pushcell(Cells *cells, Cursor co) {
+  if (cells->len == cells->cap) {
+    cells->cap = cells->cap ? cells->cap * 2 : 256;
+    cells->xs = xrealloc(cells->xs, cells->cap * sizeof(Cursor));
+  }
+  cells->xs[cells->len++] = co;
+}
+
+// The cheapest path from (from) to (to) through the (n) clusters (cls) alone:
+// Dial's algorithm over those, stopping at (to). (slot) maps each of them to
+// its place in (cls), and every other cluster to -1.
+static Cells corridorpath(Hpa const *h, int const *cls, int n,
+                          int32_t const *slot, Cursor from, Cursor to,
+                          uint32_t *cost) {
+  Grid const *shape = &h->m->shape;
+  size_t area = (size_t)h->size * h->size;
+  uint32_t *costs = xmalloc(n * area * sizeof(uint32_t));
+  memset(costs, 0xff, n * area * sizeof(uint32_t));
+  unsigned char *dirs = xmalloc(n * area);
+#define CELL(r, c)                                                             \
+  (slot[clusterof(h, r, c)] * area + (r) % h->size * h->size + (c) % h->size)
+
+  Cells q[MAXRISK + 1] = {0};
+  costs[CELL(from.row, from.column)] = 0;
+  pushcell(&q[0], from);
+  long pending = 1, settled = 0;
+  uint32_t d = 0;
+  for (bool found = false; pending && !found; d++) {
+    Cells *b = &q[d % (MAXRISK + 1)];
+    for (long k = 0; k < b->len && !found; k++) {
+      Cursor co = b->xs[k];
+      pending--;
+      if (costs[CELL(co.row, co.column)] != d) {
+        continue;
+      }
+      settled++;
+      found = co.row == to.row && co.column == to.column;
+      for (int dir = 0; dir < 4; dir++) {
+        int r = co.row + n4rows[dir], c = co.column + n4cols[dir];
+        if (r < 0 || r >= shape->height || c < 0 || c >= shape->width ||
+            slot[clusterof(h, r, c)] < 0) {
+          continue;
+        }
+        size_t j = CELL(r, c);
+        uint32_t x = d + riskat(h->m, gridindex(shape, r, c), r, c);
+        if (x < costs[j]) {
+          costs[j] = x;
+          dirs[j] = oppositedir(dir);
+          pushcell(&q[x % (MAXRISK + 1)], cursor(r, c));
+          pending++;
+        }
+      }
+    }
+    b->len = 0;
+  }
+  for (int k = 0; k <= MAXRISK; k++) {
+    free(q[k].xs);
+  }
+  dbgprintf("HPA: refined through %d clusters, settling %ld cells\n", n,
+            settled);
+
+  // Back from the goal, then turned around.
+  *cost = costs[CELL(to.row, to.column)];
+  Cells cells = {0};
+  for (Cursor co = to;; ) {
+    pushcell(&cells, co);
+    if (co.row == from.row && co.column == from.column) {
+      break;
+    }
+    int dir = dirs[CELL(co.row, co.column)];
+    co = cursor(co.row + n4rows[dir], co.column + n4cols[dir]);
+  }
+  for (long k = 0; k < cells.len / 2; k++) {
+    Cursor t = cells.xs[k];
+    cells.xs[k] = cells.xs[cells.len - 1 - k];
+    cells.xs[cells.len - 1 - k] = t;
+  }
+#undef CELL
+  free(costs);
+  free(dirs);
+  return cells;
+}
+
+long xhpapath(Hpa *h, Cursor from, Cursor to, Cursor **path, uint32_t *cost) {
+  if (!h->stamp) {
+    h->dist = xcalloc(h->nnodes + 1, sizeof(uint32_t));
+    h->parent = xcalloc(h->nnodes + 1, sizeof(int32_t));
+    h->stamp = xcalloc(h->nnodes + 1, sizeof(uint32_t));
+    h->slot = xmalloc(h->crows * h->ccols * sizeof(int32_t));
+    memset(h->slot, 0xff, h->crows * h->ccols * sizeof(int32_t));
+  }
+  if (++h->query == 0) {
+    memset(h->stamp, 0, h->nnodes * sizeof(uint32_t));
+    h->query = 1;
+  }
+  int cs = clusterof(h, PRIcursor(from)), cg = clusterof(h, PRIcursor(to));
+  Window ws, wg;
+  openwindow(h, cs, &ws);
+  openwindow(h, cg, &wg);
+  windowdial(&ws, PRIcursor(from));
+
+  // The cost of the cheapest path seen, and the node it leaves the abstract
+  // graph from (-1: it never enters it).
+  uint32_t best = cs == cg ? windowcost(&ws, PRIcursor(to)) : UNREACHED;
+  long exit = -1;
+  // From each node of the goal's cluster, the cost on to the goal.
+  long kg = h->first[cg + 1] - h->first[cg];
+  uint32_t *left = xcalloc(kg + 1, sizeof(uint32_t));
+  for (long b = 0; b < kg; b++) {
+    int32_t const *p = &h->nodes[3 * (h->first[cg] + b)];
+    windowdial(&wg, p[0], p[1]);
+    left[b] = windowcost(&wg, PRIcursor(to));
+  }
+
+  Heap q = {0};
+  for (long a = h->first[cs]; a < h->first[cs + 1]; a++) {
+    int32_t const *p = &h->nodes[3 * a];
+    uint32_t d = windowcost(&ws, p[0], p[1]);
+    if (d < nodedist(h, a)) {
+      setdist(h, a, d, -1);
+      pushheap(&q, d + bound(h, a, to), a);
+    }
+  }
+  long settled = 0;
+  while (q.len) {
+    HeapItem top = popheap(&q);
+    if (top.key >= best) {
+      break;
+    }
+    long a = top.node;
+    uint32_t d = nodedist(h, a);
+    if (top.key != d + bound(h, a, to)) {
+      continue; // stale
+    }
+    settled++;
+    int32_t const *p = &h->nodes[3 * a];
+    int cl = clusterof(h, p[0], p[1]);
+    long k = h->first[cl + 1] - h->first[cl], la = a - h->first[cl];
+    if (cl == cg && d + left[la] < best) {
+      best = d + left[la];
+      exit = a;
+    }
+    int32_t const *t = &h->nodes[3 * p[2]];
+    uint32_t dt = d + riskat(h->m, gridindex(&h->m->shape, t[0], t[1]), t[0],
+                             t[1]);
+    if (dt < nodedist(h, p[2])) {
+      setdist(h, p[2], dt, a);
+      pushheap(&q, dt + bound(h, p[2], to), p[2]);
+    }
+    uint32_t const *row = &h->cost[h->costoff[cl] + la * k];
+    for (long lb = 0; lb < k; lb++) {
+      long b = h->first[cl] + lb;
+      if (d + row[lb] < nodedist(h, b)) {
+        setdist(h, b, d + row[lb], a);
+        pushheap(&q, d + row[lb] + bound(h, b, to), b);
+      }
+    }
+  }
+  free(q.xs);
+  free(left);
+  dbgprintf("HPA: settled %ld nodes, cost %u\n", settled, best);
+
+  // Refine: search the clusters the route runs through, and only those.
+  // The route itself is one of the paths there, so this costs no more, and
+  // it is free to cross borders anywhere in between.
+  int *cls = xcalloc(2 + (exit < 0 ? 0 : h->nnodes), sizeof(int));
+  int n = 0;
+  int32_t *slot = h->slot;
+  for (long a = exit;; a = h->parent[a]) {
+    int cl = a < 0 ? cs : clusterof(h, h->nodes[3 * a], h->nodes[3 * a + 1]);
+    if (slot[cl] < 0) {
+      slot[cl] = n;
+      cls[n++] = cl;
+    }
+    if (a < 0) {
+      break;
+    }
+  }
+  if (slot[cg] < 0) {
+    slot[cg] = n;
+    cls[n++] = cg;
+  }
+  Cells cells = corridorpath(h, cls, n, slot, from, to, cost);
+  for (int k = 0; k < n; k++) {
+    slot[cls[k]] = -1;
+  }
+  free(cls);
+  closewindow(&ws);
+  closewindow(&wg);
+
+  *path = cells.xs;
+  return cells.len;
+}
@@ -0,0 +1,60 @@
+#ifndef HPA_H
+#define HPA_H
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pack.h"
+#include "sssp.h"
+
+// Hierarchical path finding (HPA*) on a risk map (see sssp.h). The map is cut
+// into clusters (size) cells square. Where two clusters touch, a pair of
+// cells facing each other across the border every (spacing) cells, and at
+// both ends, become nodes of an abstract graph: each node has an edge to its
+// twin across the border and to every other node of its cluster, costed
+// exactly by a search inside the cluster. A query searches the abstract graph
+// and only then the clusters along the route found.
+//
+// The abstract graph only crosses borders at nodes. The path returned is the
+// cheapest through the clusters of the route found there, which can still
+// cost a little more than the cheapest overall: the smaller (spacing), the
+// closer, and the bigger the graph.
+
+typedef struct {
+  RiskMap const *m;
+  int size, spacing;
+  int crows, ccols; // clusters down and across
+  long nnodes;
+  // Per node: row, column, and the index of its twin. The nodes of a cluster
+  // are consecutive, by border in the order of gridn4() and then by position.
+  int32_t const *nodes;
+  // Per cluster, row-major: its first node. The last entry is (nnodes).
+  int32_t const *first;
+  // Per cluster of k nodes: k by k costs from each node to each other.
+  uint32_t const *cost;
+  size_t *costoff; // per cluster: where its costs start
+  Pack *pk;        // the file the arrays above live in, or NULL if built
+  // Scratch for queries, stamped with the query that wrote it last.
+  uint32_t *dist;
+  int32_t *parent;
+  uint32_t *stamp, query;
+  int32_t *slot; // per cluster: where a query keeps its cells, or -1
+} Hpa;
+
+// Build the abstract graph of (m), which must outlive it. Abort on failure.
+Hpa xmkhpa(RiskMap const *m, int size, int spacing);
+
+// Load the graph saved at (path) by xsavehpa() into (*h). Return false,
+// leaving (*h) alone, if there is no such file, or it was made for another
+// map or with another (size) or (spacing). Abort if it is malformed.
+bool xloadhpa(Hpa *h, RiskMap const *m, char const *path, int size,
+              int spacing);
+
+// Save the graph to (path) as a pack (see pack.h). Abort on failure.
+void xsavehpa(Hpa const *h, char const *path);
+
+void freehpa(Hpa *h);
+
+// The cells of a path from (from) to (to), in (*path), and its cost, in
+// (*cost). Return their number. Abort on failure.
+long xhpapath(Hpa *h, Cursor from, Cursor to, Cursor **path, uint32_t *cost);
+#endif
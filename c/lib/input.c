@@ -0,0 +1,161 @@
+#include "xalloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "input.h"
+
+// Block size for non-mappable inputs.
+#define BLOCK (1 << 20)
+
+// The mapping is private and writable so that, as with a heap buffer, callers
+// may scribble on it without touching the file.
+static Input *mapinput(int fd, size_t size) {
+  void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  if (p == MAP_FAILED) {
+    return NULL;
+  }
+  madvise(p, size, MADV_SEQUENTIAL);
+  Input *in = xmalloc(sizeof(Input));
+  *in = (Input){.buf = p, .len = size, .pos = 0, .mapped = true};
+  return in;
+}
+
+Input *xreadinput(int fd) {
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    Input *in = mapinput(fd, st.st_size);
+    if (in) {
+      return in;
+    }
+    // Fall through to plain reads if the mapping fails.
+  }
+
+  Input *in = xmalloc(sizeof(Input));
+  size_t cap = BLOCK;
+  *in = (Input){.buf = xmalloc(cap), .len = 0, .pos = 0, .mapped = false};
+  for (;;) {
+    if (cap - in->len < BLOCK) {
+      cap *= 2;
+      in->buf = xrealloc(in->buf, cap);
+    }
+    ssize_t n = read(fd, in->buf + in->len, cap - in->len);
+    if (n == 0) {
+      break;
+    } else if (n < 0) {
+      perror("xreadinput: read");
+      abort();
+    }
+    in->len += n;
+  }
+  return in;
+}
+
+Input *xopeninput(char const *path) {
+  if (!path || strcmp(path, "-") == 0) {
+    return xreadinput(STDIN_FILENO);
+  }
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "xopeninput: cannot open \"%s\": ", path);
+    perror(NULL);
+    abort();
+  }
+  Input *in = xreadinput(fd);
+  close(fd);
+  return in;
+}
+
+void closeinput(Input *in) {
+  if (in->mapped) {
+    munmap(in->buf, in->len);
+  } else {
+    free(in->buf);
+  }
+  free(in);
+}
+
+bool nextline(Input *in, StrView *line) {
+  if (in->pos >= in->len) {
+    return false;
+  }
+  char const *start = in->buf + in->pos;
+  size_t left = in->len - in->pos;
+  char const *nl = memchr(start, '\n', left);
+  size_t n = nl ? (size_t)(nl - start) : left;
+  *line = (StrView){.p = start, .len = n};
+  in->pos += nl ? n + 1 : n;
+  return true;
+}
+
+static bool isspacec(char c) {
+  return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' ||
+         c == '\f';
+}
+
+bool nexttoken(Input *in, StrView *tok) {
+  while (in->pos < in->len && isspacec(in->buf[in->pos])) {
+    in->pos++;
+  }
+  if (in->pos >= in->len) {
+    return false;
+  }
+  size_t start = in->pos;
+  while (in->pos < in->len && !isspacec(in->buf[in->pos])) {
+    in->pos++;
+  }
+  *tok = (StrView){.p = in->buf + start, .len = in->pos - start};
+  return true;
+}
+
+bool inputdone(Input *in) {
+  while (in->pos < in->len && isspacec(in->buf[in->pos])) {
+    in->pos++;
+  }
+  return in->pos >= in->len;
+}
+
+bool svprefix(StrView v, char const *prefix) {
+  size_t n = strlen(prefix);
+  return v.len >= n && memcmp(v.p, prefix, n) == 0;
+}
+
+StrView svskip(StrView v, size_t n) {
+  n = n < v.len ? n : v.len;
+  return (StrView){.p = v.p + n, .len = v.len - n};
+}
+
+long svtol(StrView v, int base, StrView *rest) {
+  size_t i = 0;
+  while (i < v.len && (v.p[i] == ' ' || v.p[i] == '\t')) {
+    i++;
+  }
+  int sign = 1;
+  if (i < v.len && (v.p[i] == '-' || v.p[i] == '+')) {
+    sign = v.p[i] == '-' ? -1 : 1;
+    i++;
+  }
+  long x = 0;
+  for (; i < v.len; i++) {
+    unsigned d = (unsigned char)v.p[i] - '0';
+    if (d >= (unsigned)base) {
+      break;
+    }
+    x = x * base + d;
+  }
+  if (rest) {
+    *rest = svskip(v, i);
+  }
+  return sign * x;
+}
+
+char *xsvdup(StrView v) {
+  char *s = xmalloc(v.len + 1);
+  memcpy(s, v.p, v.len);
+  s[v.len] = '\0';
+  return s;
+}
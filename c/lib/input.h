@@ -0,0 +1,60 @@
+#ifndef INPUT_H
+#define INPUT_H
+#include <stdbool.h>
+#include <stddef.h>
+
+// A pointer/length view into an input buffer. Views are NOT null-terminated
+// and stay valid until the input is closed.
+typedef struct {
+  char const *p;
+  size_t len;
+} StrView;
+
+// The whole of an input, either memory-mapped (regular files) or read into a
+// heap buffer in large blocks (pipes, terminals). The line and token
+// iterators below advance (pos).
+typedef struct {
+  char *buf;
+  size_t len;
+  size_t pos;
+  bool mapped;
+} Input;
+
+// Open and load the file at (path), or standard input if path is NULL or
+// "-". Abort on failure.
+Input *xopeninput(char const *path);
+
+// Load everything readable from an open file descriptor. Abort on failure.
+Input *xreadinput(int fd);
+
+// Release the buffer. Every view into it becomes invalid.
+void closeinput(Input *in);
+
+// Store the next line (without its '\n') in (line). Return false at end of
+// input. A final line without a '\n' is still returned.
+bool nextline(Input *in, StrView *line);
+
+// Store the next whitespace-separated token in (tok). Return false at end of
+// input.
+bool nexttoken(Input *in, StrView *tok);
+
+// True if the input has nothing left but whitespace.
+bool inputdone(Input *in);
+
+// True if (v) begins with the C-string (prefix).
+bool svprefix(StrView v, char const *prefix);
+
+// Drop (n) characters from the front of (v) (or all of them, if fewer).
+StrView svskip(StrView v, size_t n);
+
+// Parse an optionally signed integer in (base), at most 10, after any leading
+// blanks, stopping at the first non-digit. Like strtol(), but bounded by the
+// view. If (rest) is non-NULL, it receives what follows the number.
+long svtol(StrView v, int base, StrView *rest);
+
+// Copy the view into a fresh null-terminated heap string or abort.
+char *xsvdup(StrView v);
+
+// Print a view with printf() as "%.*s", PRIsv(v).
+#define PRIsv(v) (int)(v).len, (v).p
+#endif
@@ -0,0 +1,882 @@
+#include "xalloc.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "octopus.h"
+#include "pack.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define OCTO_X86 1
+#endif
+
+// Row kernels over the cells [lo, n) of a row. The vector versions do what
+// they can in whole vectors and leave the rest to the scalar ones.
+struct octokernels_t {
+  char const *name;
+  // Add 1 to each cell. Those over 9 flash: set them to -1 and their bytes
+  // in (fl) to 1, the others' to 0. Return how many flashed.
+  int (*start)(signed char *cell, signed char *fl, int lo, int n);
+  // Add to each cell that has not flashed the flashes around it in (up),
+  // (mid) and (down), the rows of the last wave above, at and below it. Then
+  // flash those over 9 as start() does, into (fl). Return how many flashed.
+  int (*wave)(signed char *cell, signed char const *up, signed char const *mid,
+              signed char const *down, signed char *fl, int lo, int n);
+  // Set the cells that flashed back to 0.
+  void (*end)(signed char *cell, int lo, int n);
+  // As wave(), for cells whose eight neighbors lie anywhere: at (nb)[0] to
+  // (nb)[7], each indexed like (cell).
+  int (*gather)(signed char *cell, signed char const *const *nb,
+                signed char *fl, int lo, int n);
+  // Add 1 to (count) for each cell that has flashed.
+  void (*tally)(signed char const *cell, unsigned char *count, int lo, int n);
+};
+
+static int start_scalar(signed char *cell, signed char *fl, int lo, int n) {
+  int flashes = 0;
+  for (int c = lo; c < n; c++) {
+    signed char x = cell[c] + 1;
+    fl[c] = x > 9;
+    cell[c] = x > 9 ? -1 : x;
+    flashes += x > 9;
+  }
+  return flashes;
+}
+
+static int wave_scalar(signed char *cell, signed char const *up,
+                       signed char const *mid, signed char const *down,
+                       signed char *fl, int lo, int n) {
+  int flashes = 0;
+  for (int c = lo; c < n; c++) {
+    int around = up[c - 1] + up[c] + up[c + 1] + mid[c - 1] + mid[c + 1] +
+                 down[c - 1] + down[c] + down[c + 1];
+    signed char x = cell[c] < 0 ? cell[c] : cell[c] + around;
+    fl[c] = x > 9;
+    cell[c] = x > 9 ? -1 : x;
+    flashes += x > 9;
+  }
+  return flashes;
+}
+
+static void end_scalar(signed char *cell, int lo, int n) {
+  for (int c = lo; c < n; c++) {
+    cell[c] = cell[c] < 0 ? 0 : cell[c];
+  }
+}
+
+static int gather_scalar(signed char *cell, signed char const *const *nb,
+                         signed char *fl, int lo, int n) {
+  int flashes = 0;
+  for (int c = lo; c < n; c++) {
+    int around = 0;
+    for (int k = 0; k < 8; k++) {
+      around += nb[k][c];
+    }
+    signed char x = cell[c] < 0 ? cell[c] : cell[c] + around;
+    fl[c] = x > 9;
+    cell[c] = x > 9 ? -1 : x;
+    flashes += x > 9;
+  }
+  return flashes;
+}
+
+static void tally_scalar(signed char const *cell, unsigned char *count, int lo,
+                         int n) {
+  for (int c = lo; c < n; c++) {
+    count[c] += cell[c] < 0;
+  }
+}
+
+#ifdef OCTO_X86
+// The same kernels over 16 cells at a time. Flashed cells are -1, and a
+// comparison yields -1 in the lanes that flash, so OR-ing the two sets them.
+// SSE2 has no signed byte max, hence the AND to reset.
+__attribute__((target("sse2"))) static int
+start_sse2(signed char *cell, signed char *fl, int lo, int n) {
+  __m128i one = _mm_set1_epi8(1), nine = _mm_set1_epi8(9);
+  int flashes = 0, c = lo;
+  for (; c + 16 <= n; c += 16) {
+    __m128i x = _mm_add_epi8(_mm_loadu_si128((__m128i const *)(cell + c)), one);
+    __m128i m = _mm_cmpgt_epi8(x, nine);
+    _mm_storeu_si128((__m128i *)(fl + c), _mm_and_si128(m, one));
+    _mm_storeu_si128((__m128i *)(cell + c), _mm_or_si128(x, m));
+    flashes += __builtin_popcount(_mm_movemask_epi8(m));
+  }
+  return flashes + start_scalar(cell, fl, c, n);
+}
+
+__attribute__((target("sse2"))) static inline __m128i
+load3_sse2(signed char const *row, int c) {
+  __m128i a = _mm_loadu_si128((__m128i const *)(row + c - 1));
+  __m128i b = _mm_loadu_si128((__m128i const *)(row + c + 1));
+  return _mm_add_epi8(a, b);
+}
+
+__attribute__((target("sse2"))) static int
+wave_sse2(signed char *cell, signed char const *up, signed char const *mid,
+          signed char const *down, signed char *fl, int lo, int n) {
+  __m128i one = _mm_set1_epi8(1), nine = _mm_set1_epi8(9);
+  __m128i none = _mm_set1_epi8(-1);
+  int flashes = 0, c = lo;
+  for (; c + 16 <= n; c += 16) {
+    __m128i s = _mm_add_epi8(load3_sse2(up, c), load3_sse2(mid, c));
+    s = _mm_add_epi8(s, load3_sse2(down, c));
+    s = _mm_add_epi8(s, _mm_loadu_si128((__m128i const *)(up + c)));
+    s = _mm_add_epi8(s, _mm_loadu_si128((__m128i const *)(down + c)));
+    __m128i x = _mm_loadu_si128((__m128i const *)(cell + c));
+    x = _mm_add_epi8(x, _mm_and_si128(s, _mm_cmpgt_epi8(x, none)));
+    __m128i m = _mm_cmpgt_epi8(x, nine);
+    _mm_storeu_si128((__m128i *)(fl + c), _mm_and_si128(m, one));
+    _mm_storeu_si128((__m128i *)(cell + c), _mm_or_si128(x, m));
+    flashes += __builtin_popcount(_mm_movemask_epi8(m));
+  }
+  return flashes + wave_scalar(cell, up, mid, down, fl, c, n);
+}
+
+__attribute__((target("sse2"))) static void end_sse2(signed char *cell,
+                                                     int lo, int n) {
+  __m128i none = _mm_set1_epi8(-1);
+  int c = lo;
+  for (; c + 16 <= n; c += 16) {
+    __m128i x = _mm_loadu_si128((__m128i const *)(cell + c));
+    x = _mm_and_si128(x, _mm_cmpgt_epi8(x, none));
+    _mm_storeu_si128((__m128i *)(cell + c), x);
+  }
+  end_scalar(cell, c, n);
+}
+
+__attribute__((target("sse2"))) static int
+gather_sse2(signed char *cell, signed char const *const *nb, signed char *fl,
+            int lo, int n) {
+  __m128i one = _mm_set1_epi8(1), nine = _mm_set1_epi8(9);
+  __m128i none = _mm_set1_epi8(-1);
+  int flashes = 0, c = lo;
+  for (; c + 16 <= n; c += 16) {
+    __m128i s = _mm_loadu_si128((__m128i const *)(nb[0] + c));
+    for (int k = 1; k < 8; k++) {
+      s = _mm_add_epi8(s, _mm_loadu_si128((__m128i const *)(nb[k] + c)));
+    }
+    __m128i x = _mm_loadu_si128((__m128i const *)(cell + c));
+    x = _mm_add_epi8(x, _mm_and_si128(s, _mm_cmpgt_epi8(x, none)));
+    __m128i m = _mm_cmpgt_epi8(x, nine);
+    _mm_storeu_si128((__m128i *)(fl + c), _mm_and_si128(m, one));
+    _mm_storeu_si128((__m128i *)(cell + c), _mm_or_si128(x, m));
+    flashes += __builtin_popcount(_mm_movemask_epi8(m));
+  }
+  return flashes + gather_scalar(cell, nb, fl, c, n);
+}
+
+// A flashed cell compares as -1, so subtracting the comparison counts it.
+__attribute__((target("sse2"))) static void
+tally_sse2(signed char const *cell, unsigned char *count, int lo, int n) {
+  __m128i zero = _mm_setzero_si128();
+  int c = lo;
+  for (; c + 16 <= n; c += 16) {
+    __m128i x = _mm_loadu_si128((__m128i const *)(cell + c));
+    __m128i k = _mm_loadu_si128((__m128i const *)(count + c));
+    k = _mm_sub_epi8(k, _mm_cmpgt_epi8(zero, x));
+    _mm_storeu_si128((__m128i *)(count + c), k);
+  }
+  tally_scalar(cell, count, c, n);
+}
+
+__attribute__((target("avx2"))) static int
+start_avx2(signed char *cell, signed char *fl, int lo, int n) {
+  __m256i one = _mm256_set1_epi8(1), nine = _mm256_set1_epi8(9);
+  int flashes = 0, c = lo;
+  for (; c + 32 <= n; c += 32) {
+    __m256i x = _mm256_loadu_si256((__m256i const *)(cell + c));
+    x = _mm256_add_epi8(x, one);
+    __m256i m = _mm256_cmpgt_epi8(x, nine);
+    _mm256_storeu_si256((__m256i *)(fl + c), _mm256_and_si256(m, one));
+    _mm256_storeu_si256((__m256i *)(cell + c), _mm256_or_si256(x, m));
+    flashes += __builtin_popcount(_mm256_movemask_epi8(m));
+  }
+  return flashes + start_scalar(cell, fl, c, n);
+}
+
+__attribute__((target("avx2"))) static inline __m256i
+load3_avx2(signed char const *row, int c) {
+  __m256i a = _mm256_loadu_si256((__m256i const *)(row + c - 1));
+  __m256i b = _mm256_loadu_si256((__m256i const *)(row + c + 1));
+  return _mm256_add_epi8(a, b);
+}
+
+__attribute__((target("avx2"))) static int
+wave_avx2(signed char *cell, signed char const *up, signed char const *mid,
+          signed char const *down, signed char *fl, int lo, int n) {
+  __m256i one = _mm256_set1_epi8(1), nine = _mm256_set1_epi8(9);
+  __m256i none = _mm256_set1_epi8(-1);
+  int flashes = 0, c = lo;
+  for (; c + 32 <= n; c += 32) {
+    __m256i s = _mm256_add_epi8(load3_avx2(up, c), load3_avx2(mid, c));
+    s = _mm256_add_epi8(s, load3_avx2(down, c));
+    s = _mm256_add_epi8(s, _mm256_loadu_si256((__m256i const *)(up + c)));
+    s = _mm256_add_epi8(s, _mm256_loadu_si256((__m256i const *)(down + c)));
+    __m256i x = _mm256_loadu_si256((__m256i const *)(cell + c));
+    x = _mm256_add_epi8(x, _mm256_and_si256(s, _mm256_cmpgt_epi8(x, none)));
+    __m256i m = _mm256_cmpgt_epi8(x, nine);
+    _mm256_storeu_si256((__m256i *)(fl + c), _mm256_and_si256(m, one));
+    _mm256_storeu_si256((__m256i *)(cell + c), _mm256_or_si256(x, m));
+    flashes += __builtin_popcount(_mm256_movemask_epi8(m));
+  }
+  return flashes + wave_scalar(cell, up, mid, down, fl, c, n);
+}
+
+__attribute__((target("avx2"))) static void end_avx2(signed char *cell,
+                                                     int lo, int n) {
+  __m256i none = _mm256_set1_epi8(-1);
+  int c = lo;
+  for (; c + 32 <= n; c += 32) {
+    __m256i x = _mm256_loadu_si256((__m256i const *)(cell + c));
+    x = _mm256_and_si256(x, _mm256_cmpgt_epi8(x, none));
+    _mm256_storeu_si256((__m256i *)(cell + c), x);
+  }
+  end_scalar(cell, c, n);
+}
+
+__attribute__((target("avx2"))) static int
+gather_avx2(signed char *cell, signed char const *const *nb, signed char *fl,
+            int lo, int n) {
+  __m256i one = _mm256_set1_epi8(1), nine = _mm256_set1_epi8(9);
+  __m256i none = _mm256_set1_epi8(-1);
+  int flashes = 0, c = lo;
+  for (; c + 32 <= n; c += 32) {
+    __m256i s = _mm256_loadu_si256((__m256i const *)(nb[0] + c));
+    for (int k = 1; k < 8; k++) {
+      s = _mm256_add_epi8(s,
+                          _mm256_loadu_si256((__m256i const *)(nb[k] + c)));
+    }
+    __m256i x = _mm256_loadu_si256((__m256i const *)(cell + c));
+    x = _mm256_add_epi8(x, _mm256_and_si256(s, _mm256_cmpgt_epi8(x, none)));
+    __m256i m = _mm256_cmpgt_epi8(x, nine);
+    _mm256_storeu_si256((__m256i *)(fl + c), _mm256_and_si256(m, one));
+    _mm256_storeu_si256((__m256i *)(cell + c), _mm256_or_si256(x, m));
+    flashes += __builtin_popcount(_mm256_movemask_epi8(m));
+  }
+  return flashes + gather_scalar(cell, nb, fl, c, n);
+}
+
+__attribute__((target("avx2"))) static void
+tally_avx2(signed char const *cell, unsigned char *count, int lo, int n) {
+  __m256i zero = _mm256_setzero_si256();
+  int c = lo;
+  for (; c + 32 <= n; c += 32) {
+    __m256i x = _mm256_loadu_si256((__m256i const *)(cell + c));
+    __m256i k = _mm256_loadu_si256((__m256i const *)(count + c));
+    k = _mm256_sub_epi8(k, _mm256_cmpgt_epi8(zero, x));
+    _mm256_storeu_si256((__m256i *)(count + c), k);
+  }
+  tally_scalar(cell, count, c, n);
+}
+#endif
+
+static OctoKernels const kernels[] = {
+    [OCTO_SCALAR] = {"scalar", start_scalar, wave_scalar, end_scalar,
+                     gather_scalar, tally_scalar},
+#ifdef OCTO_X86
+    [OCTO_SSE2] = {"sse2", start_sse2, wave_sse2, end_sse2, gather_sse2,
+                   tally_sse2},
+    [OCTO_AVX2] = {"avx2", start_avx2, wave_avx2, end_avx2, gather_avx2,
+                   tally_avx2},
+#endif
+};
+
+bool octoisa(OctoIsa isa) {
+  switch (isa) {
+  case OCTO_AUTO:
+  case OCTO_SCALAR:
+    return true;
+#ifdef OCTO_X86
+  case OCTO_SSE2:
+    return __builtin_cpu_supports("sse2");
+  case OCTO_AVX2:
+    return __builtin_cpu_supports("avx2");
+#endif
+  default:
+    return false;
+  }
+}
+
+// The kernels for (isa), or abort on behalf of (who).
+static OctoKernels const *xkernels(OctoIsa isa, char const *who) {
+  if (isa == OCTO_AUTO) {
+    isa = octoisa(OCTO_AVX2)   ? OCTO_AVX2
+          : octoisa(OCTO_SSE2) ? OCTO_SSE2
+                               : OCTO_SCALAR;
+  }
+  if (!octoisa(isa)) {
+    fprintf(stderr, "%s: this CPU lacks the kernels asked for\n", who);
+    abort();
+  }
+  return &kernels[isa];
+}
+
+Octopuses xmkoctopuses(Grid *g, OctoIsa isa) {
+  OctoKernels const *k = xkernels(isa, "xmkoctopuses");
+  // The stencil reads one cell into the halo on every side.
+  if (g->halo < 1) {
+    fprintf(stderr, "xmkoctopuses: the grid needs a halo\n");
+    abort();
+  }
+  Octopuses o = {.g = g, .k = k};
+  int chunks = (g->width + OCTO_CHUNK - 1) / OCTO_CHUNK;
+  o.words = (chunks + 63) / 64;
+  for (int b = 0; b < 2; b++) {
+    o.flash[b] = xmkgridlayer(g, 1);
+    // Rows -1 and height stay clear.
+    o.chunks[b] = xcalloc((size_t)(g->height + 2) * o.words, sizeof(uint64_t));
+    o.chunks[b] += o.words;
+    o.rows[b] = xcalloc(g->height, sizeof(int));
+  }
+  o.work = xcalloc((size_t)g->width * g->height, sizeof(ptrdiff_t));
+  return o;
+}
+
+void freeoctopuses(Octopuses *o) {
+  for (int b = 0; b < 2; b++) {
+    freegridlayer(o->g, o->flash[b], 1);
+    free(o->chunks[b] - o->words);
+    free(o->rows[b]);
+  }
+  free(o->work);
+}
+
+char const *octoname(Octopuses const *o) { return o->k->name; }
+
+// The chunk bits of row (r) of layer (b).
+static inline uint64_t *chunkbits(Octopuses *o, int b, int r) {
+  return o->chunks[b] + (ptrdiff_t)r * o->words;
+}
+
+// The chunks of row (r) of layer (b) next to one with flashes in the rows
+// above, at or below, into (near).
+static void nearchunks(Octopuses *o, int b, int r, uint64_t *near) {
+  uint64_t const *up = chunkbits(o, b, r - 1), *mid = chunkbits(o, b, r),
+                 *down = chunkbits(o, b, r + 1);
+  uint64_t carry = 0;
+  for (int q = 0; q < o->words; q++) {
+    uint64_t x = up[q] | mid[q] | down[q];
+    uint64_t after =
+        q + 1 < o->words ? up[q + 1] | mid[q + 1] | down[q + 1] : 0;
+    near[q] = x | x << 1 | x >> 1 | carry | after << 63;
+    carry = x >> 63;
+  }
+}
+
+// Finish the cascade from the flashes of the last wave, in layer (b), a flash
+// at a time. Return how many more there were.
+static long flashtail(Octopuses *o, int b) {
+  Grid *g = o->g;
+  size_t len = 0;
+  for (int j = 0; j < o->nrows[b]; j++) {
+    int r = o->rows[b][j];
+    uint64_t const *bits = chunkbits(o, b, r);
+    ptrdiff_t i = gridindex(g, r, 0);
+    for (int q = 0; q < o->words; q++) {
+      for (uint64_t x = bits[q]; x; x &= x - 1) {
+        int c = (q * 64 + __builtin_ctzll(x)) * OCTO_CHUNK;
+        int end = c + OCTO_CHUNK < g->width ? c + OCTO_CHUNK : g->width;
+        for (; c < end; c++) {
+          if (o->flash[b][i + c]) {
+            o->work[len++] = i + c;
+          }
+        }
+      }
+    }
+  }
+
+  // Flashed octopuses and the halo are negative, and an octopus is flashed
+  // as it goes on the list.
+  long flashes = 0;
+  Stencil n8 = gridn8(g);
+  while (len) {
+    ptrdiff_t i = o->work[--len];
+    FORSTENCIL(j, i, n8) {
+      if (g->cells[j] >= 0 && ++g->cells[j] > 9) {
+        g->cells[j] = -1;
+        o->work[len++] = j;
+        flashes++;
+      }
+    }
+  }
+  return flashes;
+}
+
+long octostep(Octopuses *o) {
+  Grid *g = o->g;
+  OctoKernels const *k = o->k;
+  int w = g->width;
+  long total = 0;
+  int cur = 0;
+  o->nrows[cur] = 0;
+  for (int r = 0; r < g->height; r++) {
+    signed char *cell = gridat(g, r, 0);
+    signed char *fl = o->flash[cur] + gridindex(g, r, 0);
+    uint64_t *bits = chunkbits(o, cur, r);
+    memset(bits, 0, o->words * sizeof(uint64_t));
+    int flashes = 0;
+    for (int c = 0; c < w; c += OCTO_CHUNK) {
+      int n = k->start(cell, fl, c, c + OCTO_CHUNK < w ? c + OCTO_CHUNK : w);
+      bits[c / OCTO_CHUNK / 64] |= (uint64_t)(n > 0) << (c / OCTO_CHUNK % 64);
+      flashes += n;
+    }
+    if (flashes) {
+      o->rows[cur][o->nrows[cur]++] = r;
+    }
+    total += flashes;
+  }
+
+  // Each wave reads the flashes of the last from one layer and writes its
+  // own to the other, over the chunks next to one with flashes of the last,
+  // after clearing those of two waves ago.
+  uint64_t near[o->words];
+  while (o->nrows[cur]) {
+    int next = cur ^ 1;
+    signed char const *fl = o->flash[cur];
+    for (int j = 0; j < o->nrows[next]; j++) {
+      int r = o->rows[next][j];
+      uint64_t *bits = chunkbits(o, next, r);
+      signed char *out = o->flash[next] + gridindex(g, r, 0);
+      for (int q = 0; q < o->words; q++) {
+        for (uint64_t x = bits[q]; x; x &= x - 1) {
+          int c = (q * 64 + __builtin_ctzll(x)) * OCTO_CHUNK;
+          memset(out + c, 0, c + OCTO_CHUNK < w ? OCTO_CHUNK : w - c);
+        }
+        bits[q] = 0;
+      }
+    }
+    o->nrows[next] = 0;
+
+    // The rows next to those listed, in order, each once.
+    int last = -1;
+    long wave = 0, covered = 0;
+    for (int j = 0; j < o->nrows[cur]; j++) {
+      int r0 = o->rows[cur][j];
+      int r1 = r0 + 1 < g->height ? r0 + 1 : r0;
+      for (int r = r0 > last + 1 ? r0 - 1 : last + 1; r <= r1; r++) {
+        if (r < 0) {
+          continue;
+        }
+        last = r;
+        nearchunks(o, cur, r, near);
+        ptrdiff_t i = gridindex(g, r, 0);
+        signed char *out = o->flash[next] + i;
+        uint64_t *bits = chunkbits(o, next, r);
+        int flashes = 0;
+        for (int q = 0; q < o->words; q++) {
+          for (uint64_t x = near[q]; x; x &= x - 1) {
+            int c = (q * 64 + __builtin_ctzll(x)) * OCTO_CHUNK;
+            if (c >= w) {
+              break;
+            }
+            int n = k->wave(g->cells + i, fl + i - g->stride, fl + i,
+                            fl + i + g->stride, out, c,
+                            c + OCTO_CHUNK < w ? c + OCTO_CHUNK : w);
+            bits[q] |= (uint64_t)(n > 0) << (c / OCTO_CHUNK % 64);
+            flashes += n;
+            covered++;
+          }
+        }
+        if (flashes) {
+          o->rows[next][o->nrows[next]++] = r;
+        }
+        wave += flashes;
+      }
+    }
+    total += wave;
+    cur = next;
+    if (2 * wave < covered) {
+      total += flashtail(o, cur);
+      break;
+    }
+  }
+
+  for (int r = 0; r < g->height; r++) {
+    k->end(gridat(g, r, 0), 0, w);
+  }
+  return total;
+}
+
+// The flashes of octopus (r, c) of every board, in layer (f).
+static inline signed char *batchflash(OctoBatch const *b, int f, int r,
+                                      int c) {
+  return b->flash[f] + ((size_t)(r + 1) * (b->width + 2) + c + 1) * b->lanes;
+}
+
+OctoBatch xmkoctobatch(int width, int height, int boards, OctoIsa isa) {
+  OctoBatch b = {
+      .width = width,
+      .height = height,
+      .boards = boards,
+      .lanes = (boards + 31) / 32 * 32,
+      .k = xkernels(isa, "xmkoctobatch"),
+  };
+  b.cells = xcalloc((size_t)width * height, b.lanes);
+  for (int f = 0; f < 2; f++) {
+    b.flash[f] = xcalloc((size_t)(width + 2) * (height + 2), b.lanes);
+  }
+  b.count = xcalloc(b.lanes, 1);
+  return b;
+}
+
+void freeoctobatch(OctoBatch *b) {
+  free(b->cells);
+  for (int f = 0; f < 2; f++) {
+    free(b->flash[f]);
+  }
+  free(b->count);
+}
+
+void octobatchstep(OctoBatch *b, int *flashes) {
+  OctoKernels const *k = b->k;
+  int cur = 0;
+  bool more = false;
+  for (int r = 0; r < b->height; r++) {
+    for (int c = 0; c < b->width; c++) {
+      more |= k->start(octobatchat(b, 0, r, c), batchflash(b, cur, r, c), 0,
+                       b->lanes);
+    }
+  }
+
+  // Waves go on while any board has flashes. Every octopus of the next layer
+  // is written, and the ring around each board stays 0.
+  while (more) {
+    int next = cur ^ 1;
+    more = false;
+    for (int r = 0; r < b->height; r++) {
+      for (int c = 0; c < b->width; c++) {
+        signed char const *nb[8] = {
+            batchflash(b, cur, r - 1, c - 1), batchflash(b, cur, r - 1, c),
+            batchflash(b, cur, r - 1, c + 1), batchflash(b, cur, r, c - 1),
+            batchflash(b, cur, r, c + 1),     batchflash(b, cur, r + 1, c - 1),
+            batchflash(b, cur, r + 1, c),     batchflash(b, cur, r + 1, c + 1),
+        };
+        more |= k->gather(octobatchat(b, 0, r, c), nb,
+                          batchflash(b, next, r, c), 0, b->lanes);
+      }
+    }
+    cur = next;
+  }
+
+  // Count the flashes of each board in byte lanes, 255 octopuses at a time.
+  memset(flashes, 0, b->boards * sizeof(int));
+  int n = b->width * b->height;
+  for (int lo = 0; lo < n; lo += 255) {
+    memset(b->count, 0, b->lanes);
+    for (int i = lo; i < n && i < lo + 255; i++) {
+      k->tally(b->cells + (size_t)i * b->lanes, b->count, 0, b->lanes);
+    }
+    for (int j = 0; j < b->boards; j++) {
+      flashes[j] += b->count[j];
+    }
+  }
+  for (int i = 0; i < n; i++) {
+    k->end(b->cells + (size_t)i * b->lanes, 0, b->lanes);
+  }
+}
+
+typedef enum { TILES_STEP, TILES_STOP } TilesPhase;
+
+// A tile: rows [top, bottom) of the board. Only its thread writes its cells,
+// and it fills its outboxes while flashing; between the barriers that follow,
+// each outbox is read and cleared by the tile it is for.
+typedef struct {
+  OctoTiles *t;
+  pthread_t thread;
+  int top, bottom;
+  ptrdiff_t first, end;    // indices where its rows start and stop
+  ptrdiff_t *work;         // octopuses due to flash
+  size_t len;
+  unsigned char *up, *down; // flashes next to each column of the next tile
+  bool sent;                // whether this round put any in an outbox
+  long flashes;
+} OctoTile;
+
+struct octotiles_t {
+  Grid *g;
+  int n;
+  OctoTile *tiles;
+  pthread_barrier_t barrier;
+  // Set between rounds by one thread.
+  TilesPhase phase;
+  bool more;
+};
+
+// Flash the listed octopuses of (tl), and those their flashes push over 9 in
+// turn. Flashes next to another tile go in its outbox.
+static void tileflash(OctoTile *tl) {
+  Grid *g = tl->t->g;
+  OctoTile *tiles = tl->t->tiles;
+  bool above = tl > tiles, below = tl < tiles + tl->t->n - 1;
+  Stencil n8 = gridn8(g);
+  while (tl->len) {
+    ptrdiff_t i = tl->work[--tl->len];
+    FORSTENCIL(j, i, n8) {
+      // Columns -1 and width of the rows next to the tile are halo.
+      if (j < tl->first && above) {
+        unsigned c = j - (tl->first - g->stride + g->halo);
+        if (c < (unsigned)g->width) {
+          tl->up[c]++;
+          tl->sent = true;
+        }
+      } else if (j >= tl->end && below) {
+        unsigned c = j - (tl->end + g->halo);
+        if (c < (unsigned)g->width) {
+          tl->down[c]++;
+          tl->sent = true;
+        }
+      } else if (g->cells[j] >= 0 && ++g->cells[j] > 9) {
+        g->cells[j] = -1;
+        tl->work[tl->len++] = j;
+        tl->flashes++;
+      }
+    }
+  }
+}
+
+// Add the flashes in (box) to row (r), and list those they push over 9.
+static void tilereceive(OctoTile *tl, unsigned char *box, int r) {
+  signed char *row = gridat(tl->t->g, r, 0);
+  for (int c = 0; c < tl->t->g->width; c++) {
+    if (box[c] && row[c] >= 0) {
+      row[c] += box[c];
+      if (row[c] > 9) {
+        row[c] = -1;
+        tl->work[tl->len++] = row + c - tl->t->g->cells;
+        tl->flashes++;
+      }
+    }
+    box[c] = 0;
+  }
+}
+
+static void tilestep(OctoTile *tl) {
+  OctoTiles *t = tl->t;
+  Grid *g = t->g;
+  tl->flashes = 0;
+  for (int r = tl->top; r < tl->bottom; r++) {
+    signed char *row = gridat(g, r, 0);
+    for (int c = 0; c < g->width; c++) {
+      if (++row[c] > 9) {
+        row[c] = -1;
+        tl->work[tl->len++] = row + c - g->cells;
+        tl->flashes++;
+      }
+    }
+  }
+  for (;;) {
+    tileflash(tl);
+    if (pthread_barrier_wait(&t->barrier) == PTHREAD_BARRIER_SERIAL_THREAD) {
+      t->more = false;
+      for (int k = 0; k < t->n; k++) {
+        t->more |= t->tiles[k].sent;
+        t->tiles[k].sent = false;
+      }
+    }
+    pthread_barrier_wait(&t->barrier);
+    if (!t->more) {
+      break;
+    }
+    if (tl > t->tiles) {
+      tilereceive(tl, tl[-1].down, tl->top);
+    }
+    if (tl < t->tiles + t->n - 1) {
+      tilereceive(tl, tl[1].up, tl->bottom - 1);
+    }
+    // The outboxes must all be emptied before any tile flashes into them
+    // again.
+    pthread_barrier_wait(&t->barrier);
+  }
+  for (int r = tl->top; r < tl->bottom; r++) {
+    signed char *row = gridat(g, r, 0);
+    for (int c = 0; c < g->width; c++) {
+      row[c] = row[c] < 0 ? 0 : row[c];
+    }
+  }
+}
+
+static void *tileloop(void *arg) {
+  OctoTile *tl = arg;
+  OctoTiles *t = tl->t;
+  for (;;) {
+    pthread_barrier_wait(&t->barrier);
+    if (t->phase == TILES_STOP) {
+      return NULL;
+    }
+    tilestep(tl);
+    pthread_barrier_wait(&t->barrier);
+  }
+}
+
+OctoTiles *xmkoctotiles(Grid *g, int nthreads) {
+  if (nthreads <= 0) {
+    nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+  }
+  nthreads = nthreads < g->height ? nthreads : g->height;
+  nthreads = nthreads > 1 ? nthreads : 1;
+  OctoTiles *t = xmalloc(sizeof(OctoTiles));
+  *t = (OctoTiles){
+      .g = g, .n = nthreads, .tiles = xcalloc(nthreads, sizeof(OctoTile))};
+  for (int k = 0; k < nthreads; k++) {
+    OctoTile *tl = &t->tiles[k];
+    *tl = (OctoTile){
+        .t = t,
+        .top = (long)g->height * k / nthreads,
+        .bottom = (long)g->height * (k + 1) / nthreads,
+        .up = xcalloc(g->width, 1),
+        .down = xcalloc(g->width, 1),
+    };
+    tl->first = gridindex(g, tl->top, -g->halo);
+    tl->end = gridindex(g, tl->bottom, -g->halo);
+    tl->work = xcalloc((size_t)(tl->bottom - tl->top) * g->width,
+                       sizeof(ptrdiff_t));
+  }
+  pthread_barrier_init(&t->barrier, NULL, nthreads);
+
+  // The thread that steps is tile 0.
+  for (int k = 1; k < nthreads; k++) {
+    int err = pthread_create(&t->tiles[k].thread, NULL, tileloop,
+                             &t->tiles[k]);
+    if (err) {
+      fprintf(stderr, "pthread_create: %s\n", strerror(err));
+      abort();
+    }
+  }
+  return t;
+}
+
+void freeoctotiles(OctoTiles *t) {
+  t->phase = TILES_STOP;
+  pthread_barrier_wait(&t->barrier);
+  for (int k = 1; k < t->n; k++) {
+    pthread_join(t->tiles[k].thread, NULL);
+  }
+  pthread_barrier_destroy(&t->barrier);
+  for (int k = 0; k < t->n; k++) {
+    free(t->tiles[k].work);
+    free(t->tiles[k].up);
+    free(t->tiles[k].down);
+  }
+  free(t->tiles);
+  free(t);
+}
+
+long octotilestep(OctoTiles *t) {
+  pthread_barrier_wait(&t->barrier);
+  tilestep(&t->tiles[0]);
+  pthread_barrier_wait(&t->barrier);
+  long flashes = 0;
+  for (int k = 0; k < t->n; k++) {
+    flashes += t->tiles[k].flashes;
+  }
+  return flashes;
+}
+
+int octotiles(OctoTiles const *t) { return t->n; }
+
+uint64_t octohash(Grid const *g) {
+  uint64_t h = 14695981039346656037u;
+  for (int r = 0; r < g->height; r++) {
+    signed char const *row = gridat(g, r, 0);
+    int c = 0;
+    for (; c + 8 <= g->width; c += 8) {
+      uint64_t x;
+      memcpy(&x, row + c, 8);
+      h = (h ^ x) * 1099511628211u;
+      h ^= h >> 29;
+    }
+    for (; c < g->width; c++) {
+      h = (h ^ (unsigned char)row[c]) * 1099511628211u;
+    }
+  }
+  return h ^ h >> 32;
+}
+
+// A checkpoint is a pack of two sections: the header below as I32s, each
+// long as its low and high halves, and the energies as U8s.
+enum {
+  CK_WIDTH,
+  CK_HEIGHT,
+  CK_STEP,
+  CK_FLASHES = CK_STEP + 2,
+  CK_ALLFLASH = CK_FLASHES + 2,
+  CK_LEN = CK_ALLFLASH + 2,
+};
+
+static void putlong(int32_t *p, long x) {
+  p[0] = (uint32_t)x;
+  p[1] = (uint32_t)((uint64_t)x >> 32);
+}
+
+static long getlong(int32_t const *p) {
+  return (long)((uint64_t)(uint32_t)p[1] << 32 | (uint32_t)p[0]);
+}
+
+void xsaveocto(char const *path, Grid const *g, OctoProgress p) {
+  int32_t head[CK_LEN] = {[CK_WIDTH] = g->width, [CK_HEIGHT] = g->height};
+  putlong(head + CK_STEP, p.step);
+  putlong(head + CK_FLASHES, p.flashes);
+  putlong(head + CK_ALLFLASH, p.allflash);
+  unsigned char *cells = xmalloc((size_t)g->width * g->height);
+  for (int r = 0; r < g->height; r++) {
+    memcpy(cells + (size_t)r * g->width, gridat(g, r, 0), g->width);
+  }
+  PackSection const sections[] = {
+      {PACK_I32, 1, CK_LEN, head},
+      {PACK_U8, g->height, g->width, cells},
+  };
+
+  // Write beside the checkpoint, then rename over it.
+  size_t len = strlen(path);
+  char *tmp = xmalloc(len + 5);
+  memcpy(tmp, path, len);
+  memcpy(tmp + len, ".tmp", 5);
+  FILE *f = fopen(tmp, "wb");
+  if (!f) {
+    perror(tmp);
+    abort();
+  }
+  xwritepack(f, sections, sizeof(sections) / sizeof(sections[0]));
+  if (fflush(f) || fsync(fileno(f)) || fclose(f) || rename(tmp, path)) {
+    perror(tmp);
+    abort();
+  }
+  free(tmp);
+  free(cells);
+}
+
+OctoProgress xloadocto(char const *path, Grid *g) {
+  Pack *pk = xloadpack(xopeninput(path));
+  PackSection *head = xpacksection(pk, 0, PACK_I32);
+  PackSection *cells = xpacksection(pk, 1, PACK_U8);
+  int32_t const *h = head->data;
+  if (head->rows * head->cols != CK_LEN || h[CK_WIDTH] != g->width ||
+      h[CK_HEIGHT] != g->height || cells->rows != (size_t)g->height ||
+      cells->cols != (size_t)g->width) {
+    fprintf(stderr, "xloadocto: %s is not a checkpoint of this board\n",
+            path);
+    abort();
+  }
+  unsigned char const *xs = cells->data;
+  for (int r = 0; r < g->height; r++) {
+    for (int c = 0; c < g->width; c++) {
+      unsigned char x = xs[(size_t)r * g->width + c];
+      if (x > 9) {
+        fprintf(stderr, "xloadocto: %s holds an energy of %d\n", path, x);
+        abort();
+      }
+      *gridat(g, r, c) = x;
+    }
+  }
+  OctoProgress p = {
+      .step = getlong(h + CK_STEP),
+      .flashes = getlong(h + CK_FLASHES),
+      .allflash = getlong(h + CK_ALLFLASH),
+  };
+  closepack(pk);
+  return p;
+}
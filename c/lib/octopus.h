@@ -0,0 +1,131 @@
+#ifndef OCTOPUS_H
+#define OCTOPUS_H
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "grid.h"
+
+// Steps of the octopus grid of day 11, with SIMD row kernels. The grid holds
+// energies 0 to 9 inside a negative halo. A step adds 1 to every octopus;
+// then every octopus over 9 flashes, once a step, adding 1 to its eight
+// neighbors; and every octopus that flashed ends the step at 0.
+//
+// Flashes spread in waves. The kernels keep the flashes of a wave as a byte
+// layer of 0s and 1s laid out like the grid, and a wave is a pass over the
+// cells next to the flashes of the wave before, each adding up the eight
+// bytes around it with the same unaligned loads as its 31 (AVX2) or 15
+// (SSE2) neighbors along the row. Comparisons give a bitmask of the new
+// flashes, which counts them. Cascades on a big board run to hundreds of
+// waves a step, mostly sparse, so a layer lists its rows with flashes and
+// marks the chunks of OCTO_CHUNK columns they are in, and a wave only covers
+// the chunks next to those. Once a wave has fewer than half as many flashes
+// as chunks, the rest of the cascade goes flash by flash, from a worklist.
+//
+// This is not the order of magnitude over the plain worklist it was meant
+// to be. In ms a step on random boards (octobench), on one machine:
+//
+//   board      rescan  worklist  scalar  SSE2  AVX2
+//   100x100     0.194     0.083   0.143  0.059 0.058
+//   300x300      2.04      0.80    1.64   0.51  0.45
+//   1000x1000    24.4       9.3    20.0    5.4   4.4
+//
+// and on another, at 300x300, 1.60 for the worklist, 1.19 for SSE2 and 1.46
+// for AVX2. The kernels beat the worklist by 1.1 to 2 times, and the scalar
+// ones lose to it.
+
+#define OCTO_CHUNK 32
+
+typedef enum { OCTO_AUTO, OCTO_SCALAR, OCTO_SSE2, OCTO_AVX2 } OctoIsa;
+
+typedef struct octokernels_t OctoKernels;
+
+typedef struct {
+  Grid *g;
+  signed char *flash[2]; // layers: 1 where an octopus flashed in the wave
+  uint64_t *chunks[2];   // per row of each layer: a bit per chunk with 1s
+  int words;             // of chunk bits a row
+  int *rows[2], nrows[2]; // of each layer: those with 1s, in order
+  ptrdiff_t *work;        // octopuses due to flash, for sparse tails
+  OctoKernels const *k;
+} Octopuses;
+
+// Whether this CPU can run the kernels for (isa).
+bool octoisa(OctoIsa isa);
+
+// Step (g) with the kernels for (isa), or the best this CPU has for
+// OCTO_AUTO. Abort if the CPU lacks them, or on failure.
+Octopuses xmkoctopuses(Grid *g, OctoIsa isa);
+
+void freeoctopuses(Octopuses *o);
+
+// Take one step. Return the number of flashes.
+long octostep(Octopuses *o);
+
+// The name of the kernels in use.
+char const *octoname(Octopuses const *o);
+
+// Many boards of one size, stepped together. The energies are laid out as a
+// structure of arrays: those of one octopus on every board side by side, so
+// that each byte lane of a vector is a board, and the kernels step 32 (AVX2)
+// or 16 (SSE2) boards at once.
+typedef struct {
+  int width, height, boards;
+  int lanes;             // boards, rounded up to a whole vector
+  signed char *cells;    // per octopus, row by row, per lane
+  signed char *flash[2]; // likewise, with a ring of 0s around the board
+  unsigned char *count;  // per lane: flashes among a run of octopuses
+  OctoKernels const *k;
+} OctoBatch;
+
+// (boards) boards of energy 0, stepped with the kernels for (isa). Abort on
+// failure.
+OctoBatch xmkoctobatch(int width, int height, int boards, OctoIsa isa);
+
+void freeoctobatch(OctoBatch *b);
+
+// The energy of octopus (r, c) of board (board).
+static inline signed char *octobatchat(OctoBatch const *b, int board, int r,
+                                       int c) {
+  return b->cells + ((size_t)r * b->width + c) * b->lanes + board;
+}
+
+// Take one step on every board. Store the number of flashes on each in
+// (flashes).
+void octobatchstep(OctoBatch *b, int *flashes);
+
+// The board split into tiles of whole rows, one per thread (0: one per
+// online CPU), each stepped by its own thread with a worklist. Flashes that
+// reach a neighboring tile go into an outbox for it; at a barrier the tiles
+// swap outboxes and flash what those push over 9, in rounds until no tile
+// sends any. The result is the same as octostep()'s whatever the tiling, as
+// the octopuses that flash in a step do not depend on the order.
+typedef struct octotiles_t OctoTiles;
+
+// Abort on failure.
+OctoTiles *xmkoctotiles(Grid *g, int nthreads);
+
+void freeoctotiles(OctoTiles *t);
+
+// Take one step on all threads. Return the number of flashes.
+long octotilestep(OctoTiles *t);
+
+int octotiles(OctoTiles const *t);
+
+// A 64-bit hash of the energies of (g), halo aside.
+uint64_t octohash(Grid const *g);
+
+// How far a long run has got.
+typedef struct {
+  long step;     // steps taken
+  long flashes;  // in all of them
+  long allflash; // the first step on which all flashed, or 0 if none yet
+} OctoProgress;
+
+// Save (g) and (p) to (path), replacing it all at once, so that an
+// interrupted save leaves the last checkpoint whole. Abort on failure.
+void xsaveocto(char const *path, Grid const *g, OctoProgress p);
+
+// Load the checkpoint at (path) into (g), which must be the same size.
+// Abort on failure or if it is not.
+OctoProgress xloadocto(char const *path, Grid *g);
+#endif
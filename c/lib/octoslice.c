@@ -0,0 +1,271 @@
+#include "xalloc.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "octoslice.h"
+
+#define ONES UINT64_MAX
+
+// Word 0 of row (r) of a mask.
+static inline uint64_t *maskrow(OctoSlice const *s, uint64_t *mask, int r) {
+  return mask + (r + 1) * s->stride + 1;
+}
+
+// The bits of row (r) of layer (b) for its words with flashes.
+static inline uint64_t *busyrow(OctoSlice const *s, int b, int r) {
+  return s->busy[b] + (r + 1) * s->busywords;
+}
+
+// The four planes of word (q) of row (r).
+static inline uint64_t *energy(OctoSlice const *s, int r, int q) {
+  return s->planes + ((size_t)r * s->words + q) * 4;
+}
+
+// The bits of word (q) in the board.
+static inline uint64_t inboard(OctoSlice const *s, int q) {
+  return q == s->words - 1 ? s->last : ONES;
+}
+
+static uint64_t *xmkmask(OctoSlice const *s) {
+  return xcalloc((size_t)(s->height + 2) * s->stride, sizeof(uint64_t));
+}
+
+OctoSlice xmkoctoslice(Grid const *g) {
+  OctoSlice s = {
+      .width = g->width,
+      .height = g->height,
+      .words = (g->width + 63) / 64,
+  };
+  s.last = g->width % 64 ? ((uint64_t)1 << g->width % 64) - 1 : ONES;
+  s.stride = s.words + 2;
+  s.busywords = (s.words + 63) / 64;
+  s.planes = xcalloc((size_t)s.height * s.words * 4, sizeof(uint64_t));
+  for (int b = 0; b < 2; b++) {
+    s.flash[b] = xmkmask(&s);
+    s.rows[b] = xcalloc(s.height, sizeof(int));
+    s.busy[b] =
+        xcalloc((size_t)(s.height + 2) * s.busywords, sizeof(uint64_t));
+  }
+  s.done = xmkmask(&s);
+  for (int r = 0; r < s.height; r++) {
+    signed char const *row = gridat(g, r, 0);
+    for (int c = 0; c < s.width; c++) {
+      uint64_t *e = energy(&s, r, c / 64);
+      for (int b = 0; b < 4; b++) {
+        e[b] |= (uint64_t)(row[c] >> b & 1) << c % 64;
+      }
+    }
+  }
+  return s;
+}
+
+void freeoctoslice(OctoSlice *s) {
+  free(s->planes);
+  for (int b = 0; b < 2; b++) {
+    free(s->flash[b]);
+    free(s->rows[b]);
+    free(s->busy[b]);
+  }
+  free(s->done);
+}
+
+void octoslicegrid(OctoSlice const *s, Grid *g) {
+  for (int r = 0; r < s->height; r++) {
+    signed char *row = gridat(g, r, 0);
+    for (int c = 0; c < s->width; c++) {
+      uint64_t const *e = energy(s, r, c / 64);
+      int x = 0;
+      for (int b = 0; b < 4; b++) {
+        x |= (int)(e[b] >> c % 64 & 1) << b;
+      }
+      row[c] = x;
+    }
+  }
+}
+
+uint64_t octoslicehash(OctoSlice const *s) {
+  uint64_t h = 14695981039346656037u;
+  size_t n = (size_t)s->height * s->words * 4;
+  for (size_t k = 0; k < n; k++) {
+    h = (h ^ s->planes[k]) * 1099511628211u;
+    h ^= h >> 29;
+  }
+  return h ^ h >> 32;
+}
+
+// Full and half adders, a bit per lane. (carry) may be one of the inputs.
+#define FULLADD(sum, carry, a, b, c)                                           \
+  do {                                                                         \
+    uint64_t a_ = (a), b_ = (b), c_ = (c), t_ = a_ ^ b_;                       \
+    sum = t_ ^ c_;                                                             \
+    carry = (a_ & b_) | (t_ & c_);                                             \
+  } while (0)
+#define HALFADD(sum, carry, a, b)                                              \
+  do {                                                                         \
+    uint64_t a_ = (a), b_ = (b);                                               \
+    sum = a_ ^ b_;                                                             \
+    carry = a_ & b_;                                                           \
+  } while (0)
+
+// Add the flashes around word (q) of row (r), from rows (up), (mid) and
+// (down) of the last wave, to the octopuses yet to flash. Return those that
+// go over 9, which flash now.
+static uint64_t wavewords(OctoSlice *s, int r, int q, uint64_t const *up,
+                          uint64_t const *mid, uint64_t const *down) {
+  // Bit c of a word is column 64q + c, so the neighbor to the left, c - 1,
+  // comes up a bit, and the one to the right comes down one.
+  uint64_t ul = up[q] << 1 | up[q - 1] >> 63, uc = up[q];
+  uint64_t ur = up[q] >> 1 | up[q + 1] << 63;
+  uint64_t ml = mid[q] << 1 | mid[q - 1] >> 63;
+  uint64_t mr = mid[q] >> 1 | mid[q + 1] << 63;
+  uint64_t dl = down[q] << 1 | down[q - 1] >> 63, dc = down[q];
+  uint64_t dr = down[q] >> 1 | down[q + 1] << 63;
+
+  // Eight bits into a count of 0 to 8: first three words of ones into ones
+  // and twos, then the twos into twos and fours, then the fours.
+  uint64_t s1, c1, s2, c2, s3, c3, n0, c4, t, c5, n1, c6;
+  FULLADD(s1, c1, ul, uc, ur);
+  FULLADD(s2, c2, ml, mr, dl);
+  HALFADD(s3, c3, dc, dr);
+  FULLADD(n0, c4, s1, s2, s3);
+  FULLADD(t, c5, c1, c2, c3);
+  HALFADD(n1, c6, t, c4);
+  uint64_t n2 = c5 ^ c6, n3 = c5 & c6;
+
+  uint64_t *done = maskrow(s, s->done, r);
+  uint64_t live = ~done[q] & inboard(s, q);
+  n0 &= live;
+  n1 &= live;
+  n2 &= live;
+  n3 &= live;
+
+  // Energy plus count, up to 17.
+  uint64_t *e = energy(s, r, q);
+  uint64_t e0, e1, e2, e3, k;
+  HALFADD(e0, k, e[0], n0);
+  FULLADD(e1, k, e[1], n1, k);
+  FULLADD(e2, k, e[2], n2, k);
+  FULLADD(e3, k, e[3], n3, k);
+  e[0] = e0;
+  e[1] = e1;
+  e[2] = e2;
+  e[3] = e3;
+  // Over 9: 16 and up, or 8 plus 2 or 4.
+  uint64_t over = (k | (e3 & (e2 | e1))) & live;
+  done[q] |= over;
+  return over;
+}
+
+long octoslicestep(OctoSlice *s) {
+  long total = 0;
+  int cur = 0;
+  s->nrows[cur] = 0;
+  for (int r = 0; r < s->height; r++) {
+    uint64_t *fl = maskrow(s, s->flash[cur], r);
+    uint64_t *done = maskrow(s, s->done, r);
+    uint64_t *busy = busyrow(s, cur, r);
+    memset(busy, 0, s->busywords * sizeof(uint64_t));
+    uint64_t any = 0;
+    for (int q = 0; q < s->words; q++) {
+      uint64_t *e = energy(s, r, q);
+      // Add 1; energies were 9 at most, so 10 fits.
+      uint64_t k = e[0];
+      e[0] = ~e[0];
+      e[1] ^= k;
+      k &= ~e[1];
+      e[2] ^= k;
+      k &= ~e[2];
+      e[3] ^= k;
+      uint64_t over = e[3] & (e[2] | e[1]) & inboard(s, q);
+      fl[q] = done[q] = over;
+      busy[q / 64] |= (uint64_t)(over != 0) << q % 64;
+      any |= over;
+      total += __builtin_popcountll(over);
+    }
+    if (any) {
+      s->rows[cur][s->nrows[cur]++] = r;
+    }
+  }
+
+  // Each wave reads the flashes of the last from one layer and writes its
+  // own to the other, after clearing those of two waves ago.
+  uint64_t near[s->busywords];
+  while (s->nrows[cur]) {
+    int next = cur ^ 1;
+    for (int j = 0; j < s->nrows[next]; j++) {
+      int r = s->rows[next][j];
+      uint64_t *out = maskrow(s, s->flash[next], r);
+      uint64_t *busy = busyrow(s, next, r);
+      for (int w = 0; w < s->busywords; w++) {
+        for (uint64_t x = busy[w]; x; x &= x - 1) {
+          out[w * 64 + __builtin_ctzll(x)] = 0;
+        }
+        busy[w] = 0;
+      }
+    }
+    s->nrows[next] = 0;
+
+    // The rows next to those listed, in order, each once.
+    int last = -1;
+    for (int j = 0; j < s->nrows[cur]; j++) {
+      int r0 = s->rows[cur][j];
+      int r1 = r0 + 1 < s->height ? r0 + 1 : r0;
+      for (int r = r0 > last + 1 ? r0 - 1 : last + 1; r <= r1; r++) {
+        if (r < 0) {
+          continue;
+        }
+        last = r;
+        // The words next to one with flashes, in this row or those beside.
+        uint64_t const *bu = busyrow(s, cur, r - 1), *bm = busyrow(s, cur, r),
+                       *bd = busyrow(s, cur, r + 1);
+        uint64_t carry = 0;
+        for (int w = 0; w < s->busywords; w++) {
+          uint64_t x = bu[w] | bm[w] | bd[w];
+          uint64_t after = w + 1 < s->busywords
+                               ? bu[w + 1] | bm[w + 1] | bd[w + 1]
+                               : 0;
+          near[w] = x | x << 1 | x >> 1 | carry | after << 63;
+          carry = x >> 63;
+        }
+
+        uint64_t const *up = maskrow(s, s->flash[cur], r - 1);
+        uint64_t const *mid = maskrow(s, s->flash[cur], r);
+        uint64_t const *down = maskrow(s, s->flash[cur], r + 1);
+        uint64_t *out = maskrow(s, s->flash[next], r);
+        uint64_t *busy = busyrow(s, next, r);
+        uint64_t any = 0;
+        for (int w = 0; w < s->busywords; w++) {
+          for (uint64_t x = near[w]; x; x &= x - 1) {
+            int q = w * 64 + __builtin_ctzll(x);
+            if (q >= s->words) {
+              break;
+            }
+            uint64_t over = wavewords(s, r, q, up, mid, down);
+            out[q] = over;
+            busy[w] |= (uint64_t)(over != 0) << q % 64;
+            any |= over;
+            total += __builtin_popcountll(over);
+          }
+        }
+        if (any) {
+          s->rows[next][s->nrows[next]++] = r;
+        }
+      }
+    }
+    cur = next;
+  }
+
+  // Those that flashed go back to 0, and so does what lies past the board.
+  for (int r = 0; r < s->height; r++) {
+    uint64_t *done = maskrow(s, s->done, r);
+    for (int q = 0; q < s->words; q++) {
+      uint64_t keep = ~done[q] & inboard(s, q);
+      uint64_t *e = energy(s, r, q);
+      for (int b = 0; b < 4; b++) {
+        e[b] &= keep;
+      }
+      done[q] = 0;
+    }
+  }
+  return total;
+}
@@ -0,0 +1,46 @@
+#ifndef OCTOSLICE_H
+#define OCTOSLICE_H
+#include <stddef.h>
+#include <stdint.h>
+
+#include "grid.h"
+
+// The octopus board of day 11 (see octopus.h) bit-sliced: each row is cut
+// into words of 64 octopuses, and a word of each of four bit-planes holds
+// their energies, 0 to 9, bit by bit. Adding 1, testing for over 9 and
+// adding up the flashes around each octopus are then adder networks over
+// whole words, 64 octopuses at a time, and the board takes half a byte an
+// octopus, plus three bits for the flashes of a step.
+//
+// A step flashes in waves. The flashes of a wave are a mask, and the eight
+// shifted masks around each word go through a carry-save adder tree into a
+// 4-bit count for each octopus, which is added to the energies of those yet
+// to flash. Only words next to a flash of the last wave are worked on.
+typedef struct {
+  int width, height;
+  int words;        // of 64 octopuses a row
+  uint64_t *planes; // per row and word, four words of energy bits, low first
+  uint64_t last;    // the bits of the last word of a row in the board
+  // Masks with a row of zeros above and below, and a word of them to each
+  // side: the flashes of a wave, in two layers, and those of the step.
+  ptrdiff_t stride;
+  uint64_t *flash[2], *done;
+  int *rows[2], nrows[2]; // of each flash layer: those with flashes, in order
+  uint64_t *busy[2];      // of each flash layer, per row: a bit per word
+  int busywords;          // with flashes, and a row of zeros above and below
+} OctoSlice;
+
+// Slice the energies of (g). Abort on failure.
+OctoSlice xmkoctoslice(Grid const *g);
+
+void freeoctoslice(OctoSlice *s);
+
+// Take one step. Return the number of flashes.
+long octoslicestep(OctoSlice *s);
+
+// Write the energies back to (g), which must be the same size.
+void octoslicegrid(OctoSlice const *s, Grid *g);
+
+// A 64-bit hash of the energies.
+uint64_t octoslicehash(OctoSlice const *s);
+#endif
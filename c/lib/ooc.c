@@ -0,0 +1,525 @@
+#include "xalloc.h"
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "dbgprint.h"
+#include "ooc.h"
+#include "pack.h"
+#include "sssp.h"
+#include "stream.h"
+
+// Among tiles whose pending costs are within this of the cheapest, one in
+// the cache goes first.
+#define SLACK (4 * MAXRISK)
+
+// A tile in memory.
+typedef struct {
+  int tile; // -1: free
+  bool dirty;
+  long used;
+  signed char *risk; // (tile) by (tile), row-major
+  uint32_t *cost;
+} CacheSlot;
+
+// A cost pending for a cell of a tile: the cost of its neighbor across the
+// border, which the cell's own risk is still to be added to.
+typedef struct {
+  uint32_t from;
+  int32_t cell;
+} Pending;
+
+typedef struct {
+  Pending *xs;
+  size_t len, cap;
+} PendingList;
+
+// Tiles keyed by their cheapest pending cost, in a binary min-heap. Entries
+// go stale when a tile is worked through or gets a cheaper cost.
+typedef struct {
+  uint32_t key;
+  int tile;
+} TileKey;
+
+typedef struct {
+  TileKey *xs;
+  size_t len, cap;
+} TileHeap;
+
+// Cells of a tile, by index.
+typedef struct {
+  int32_t *xs;
+  size_t len, cap;
+} CellList;
+
+struct tilestore_t {
+  int fd;
+  int width, height, tile;
+  int trows, tcols;
+  size_t area; // cells in a tile
+  CacheSlot *slots;
+  int nslots;
+  int *where;   // per tile: its slot, or -1
+  bool *stored; // per tile: its costs were written back since the reset
+  long clock;
+  PendingList *pending; // per tile
+  uint32_t *cheapest;   // per tile: the least (from) pending, or UNREACHED
+  TileHeap heap;
+  CellList q[MAXRISK + 1];
+  TileStats stats;
+};
+
+static off_t tileoffset(TileStore const *ts, int t) {
+  return (off_t)t * (off_t)ts->area * (1 + sizeof(uint32_t));
+}
+
+static void xpwrite(TileStore *ts, void const *p, size_t n, off_t off) {
+  for (size_t done = 0; done < n;) {
+    ssize_t k = pwrite(ts->fd, (char const *)p + done, n - done, off + done);
+    if (k < 0) {
+      perror("tile store: pwrite");
+      abort();
+    }
+    done += k;
+  }
+  ts->stats.byteswritten += n;
+}
+
+static void xpread(TileStore *ts, void *p, size_t n, off_t off) {
+  for (size_t done = 0; done < n;) {
+    ssize_t k = pread(ts->fd, (char *)p + done, n - done, off + done);
+    if (k <= 0) {
+      perror("tile store: pread");
+      abort();
+    }
+    done += k;
+  }
+  ts->stats.bytesread += n;
+}
+
+// Rows of the map, a band of (tile) rows at a time.
+typedef struct {
+  Stream *stream; // text, from the file or standard input
+  Input block;
+  Pack *pk; // or a pack
+  size_t row;
+} RowSource;
+
+// The next row of the map, into (*line). Return false at the end.
+static bool nextrow(RowSource *src, StrView *line) {
+  if (src->pk) {
+    PackSection *s = &src->pk->sections[0];
+    if (src->row == s->rows) {
+      return false;
+    }
+    *line = (StrView){(char const *)s->data + src->row++ * s->cols, s->cols};
+    return true;
+  }
+  while (!nextline(&src->block, line)) {
+    if (!nextblock(src->stream, &src->block)) {
+      return false;
+    }
+  }
+  if (!line->len) {
+    return false; // the grid ends at an empty line
+  }
+  return true;
+}
+
+// Open the map at (path), or standard input, for reading a row at a time.
+static RowSource openrows(char const *path) {
+  RowSource src = {0};
+  int fd = 0;
+  if (path) {
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+      perror(path);
+      abort();
+    }
+    char head[sizeof(PACKMAGIC) - 1];
+    if (pread(fd, head, sizeof(head), 0) == sizeof(head) &&
+        memcmp(head, PACKMAGIC, sizeof(head)) == 0) {
+      close(fd);
+      src.pk = xloadpack(xopeninput(path));
+      xpacksection(src.pk, 0, PACK_U8);
+      return src;
+    }
+  }
+  src.stream = xopenstream(fd, STREAMBLOCK);
+  return src;
+}
+
+static void closerows(RowSource *src) {
+  if (src->pk) {
+    closepack(src->pk);
+  } else {
+    closestream(src->stream);
+  }
+}
+
+// Write a band of (rows) rows of risks, (tile) rows at most, as the tiles of
+// tile row (tr).
+static void writeband(TileStore *ts, signed char const *band, int rows,
+                      int tr) {
+  signed char *buf = xcalloc(ts->area, 1);
+  for (int tc = 0; tc < ts->tcols; tc++) {
+    int c0 = tc * ts->tile;
+    int width = ts->width - c0 < ts->tile ? ts->width - c0 : ts->tile;
+    memset(buf, 0, ts->area);
+    for (int r = 0; r < rows; r++) {
+      memcpy(buf + (size_t)r * ts->tile, band + (size_t)r * ts->width + c0,
+             width);
+    }
+    xpwrite(ts, buf, ts->area, tileoffset(ts, tr * ts->tcols + tc));
+  }
+  free(buf);
+}
+
+TileStore *xmktilestore(char const *map, char const *path, int tile,
+                        int cache) {
+  TileStore *ts = xcalloc(1, sizeof(TileStore));
+  ts->tile = tile;
+  ts->area = (size_t)tile * tile;
+  if (path) {
+    ts->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  } else {
+    FILE *f = tmpfile();
+    ts->fd = f ? dup(fileno(f)) : -1;
+    if (f) {
+      fclose(f);
+    }
+  }
+  if (ts->fd < 0) {
+    perror(path ? path : "tmpfile");
+    abort();
+  }
+
+  // A band of rows is all of the map ever held at once.
+  RowSource src = openrows(map);
+  StrView line;
+  signed char *band = NULL;
+  int rows = 0;
+  while (nextrow(&src, &line)) {
+    if (!band) {
+      ts->width = line.len;
+      band = xcalloc((size_t)tile * ts->width, 1);
+      ts->tcols = (ts->width + tile - 1) / tile;
+    } else if (line.len != (size_t)ts->width) {
+      fprintf(stderr, "xmktilestore: row %d is %zu cells wide, not %d\n",
+              ts->height, line.len, ts->width);
+      abort();
+    }
+    signed char *row = band + (size_t)rows * ts->width;
+    for (int c = 0; c < ts->width; c++) {
+      row[c] = src.pk ? line.p[c] : line.p[c] - '0';
+      if (row[c] < 0 || row[c] > MAXRISK) {
+        fprintf(stderr, "xmktilestore: bad risk at (%d, %d)\n", ts->height,
+                c);
+        abort();
+      }
+    }
+    ts->height++;
+    if (++rows == tile) {
+      writeband(ts, band, rows, ts->height / tile - 1);
+      rows = 0;
+    }
+  }
+  if (rows) {
+    writeband(ts, band, rows, ts->height / tile);
+  }
+  free(band);
+  closerows(&src);
+  if (!ts->height) {
+    fprintf(stderr, "xmktilestore: empty map\n");
+    abort();
+  }
+  ts->trows = (ts->height + tile - 1) / tile;
+  int ntiles = ts->trows * ts->tcols;
+
+  ts->nslots = cache < ntiles ? cache : ntiles;
+  ts->slots = xcalloc(ts->nslots, sizeof(CacheSlot));
+  for (int k = 0; k < ts->nslots; k++) {
+    ts->slots[k] = (CacheSlot){.tile = -1,
+                               .risk = xmalloc(ts->area),
+                               .cost = xmalloc(ts->area * sizeof(uint32_t))};
+  }
+  ts->where = xmalloc(ntiles * sizeof(int));
+  memset(ts->where, 0xff, ntiles * sizeof(int));
+  ts->stored = xcalloc(ntiles, sizeof(bool));
+  ts->pending = xcalloc(ntiles, sizeof(PendingList));
+  ts->cheapest = xmalloc(ntiles * sizeof(uint32_t));
+  memset(ts->cheapest, 0xff, ntiles * sizeof(uint32_t));
+  dbgprintf("Tile store: %d by %d cells in %d by %d tiles, %d cached\n",
+            ts->height, ts->width, ts->trows, ts->tcols, ts->nslots);
+  ts->stats = (TileStats){0};
+  return ts;
+}
+
+void tilemapsize(TileStore const *ts, int *width, int *height) {
+  *width = ts->width;
+  *height = ts->height;
+}
+
+TileStats tilestats(TileStore const *ts) { return ts->stats; }
+
+void closetilestore(TileStore *ts) {
+  for (int k = 0; k < ts->nslots; k++) {
+    free(ts->slots[k].risk);
+    free(ts->slots[k].cost);
+  }
+  int ntiles = ts->trows * ts->tcols;
+  for (int t = 0; t < ntiles; t++) {
+    free(ts->pending[t].xs);
+  }
+  for (int k = 0; k <= MAXRISK; k++) {
+    free(ts->q[k].xs);
+  }
+  free(ts->slots);
+  free(ts->where);
+  free(ts->stored);
+  free(ts->pending);
+  free(ts->cheapest);
+  free(ts->heap.xs);
+  close(ts->fd);
+  free(ts);
+}
+
+// Tile (t) in memory, paging out the least recently used if need be.
+static CacheSlot *xloadtile(TileStore *ts, int t) {
+  ts->clock++;
+  if (ts->where[t] >= 0) {
+    CacheSlot *sl = &ts->slots[ts->where[t]];
+    sl->used = ts->clock;
+    ts->stats.hits++;
+    return sl;
+  }
+  CacheSlot *sl = &ts->slots[0];
+  for (int k = 1; k < ts->nslots && sl->tile >= 0; k++) {
+    if (ts->slots[k].tile < 0 || ts->slots[k].used < sl->used) {
+      sl = &ts->slots[k];
+    }
+  }
+  if (sl->tile >= 0) {
+    if (sl->dirty) {
+      xpwrite(ts, sl->cost, ts->area * sizeof(uint32_t),
+              tileoffset(ts, sl->tile) + ts->area);
+      ts->stored[sl->tile] = true;
+      ts->stats.writebacks++;
+    }
+    ts->where[sl->tile] = -1;
+  }
+  xpread(ts, sl->risk, ts->area, tileoffset(ts, t));
+  if (ts->stored[t]) {
+    xpread(ts, sl->cost, ts->area * sizeof(uint32_t),
+           tileoffset(ts, t) + ts->area);
+  } else {
+    // Never written back: every cost is still UNREACHED.
+    memset(sl->cost, 0xff, ts->area * sizeof(uint32_t));
+  }
+  *sl = (CacheSlot){
+      .tile = t, .used = ts->clock, .risk = sl->risk, .cost = sl->cost};
+  ts->where[t] = sl - ts->slots;
+  ts->stats.loads++;
+  return sl;
+}
+
+static void pushtile(TileHeap *h, uint32_t key, int tile) {
+  if (h->len == h->cap) {
+    h->cap = h->cap ? h->cap * 2 : 64;
+    h->xs = xrealloc(h->xs, h->cap * sizeof(TileKey));
+  }
+  size_t k = h->len++;
+  for (; k && h->xs[(k - 1) / 2].key > key; k = (k - 1) / 2) {
+    h->xs[k] = h->xs[(k - 1) / 2];
+  }
+  h->xs[k] = (TileKey){key, tile};
+}
+
+static TileKey poptile(TileHeap *h) {
+  TileKey top = h->xs[0], last = h->xs[--h->len];
+  size_t k = 0;
+  for (size_t child; (child = 2 * k + 1) < h->len; k = child) {
+    if (child + 1 < h->len && h->xs[child + 1].key < h->xs[child].key) {
+      child++;
+    }
+    if (h->xs[child].key >= last.key) {
+      break;
+    }
+    h->xs[k] = h->xs[child];
+  }
+  h->xs[k] = last;
+  return top;
+}
+
+static void pushcell(CellList *q, int32_t i) {
+  if (q->len == q->cap) {
+    q->cap = q->cap ? q->cap * 2 : 64;
+    q->xs = xrealloc(q->xs, q->cap * sizeof(int32_t));
+  }
+  q->xs[q->len++] = i;
+}
+
+// Queue cost (from) for cell (cell) of tile (t).
+static void sendpending(TileStore *ts, int t, int32_t cell, uint32_t from) {
+  PendingList *p = &ts->pending[t];
+  if (p->len == p->cap) {
+    p->cap = p->cap ? p->cap * 2 : 16;
+    p->xs = xrealloc(p->xs, p->cap * sizeof(Pending));
+  }
+  p->xs[p->len++] = (Pending){from, cell};
+  if (from < ts->cheapest[t]) {
+    ts->cheapest[t] = from;
+    pushtile(&ts->heap, from, t);
+  }
+}
+
+static int cmppending(void const *a, void const *b) {
+  uint32_t x = ((Pending const *)a)->from, y = ((Pending const *)b)->from;
+  return (x > y) - (x < y);
+}
+
+// Work through tile (t): take in its pending costs, plus cell (seed) at cost
+// 0 unless it is -1, and spread them with Dial's algorithm. Lower (*goal),
+// the cost of cell (goalcell) of tile (goaltile), when it is reached.
+static void passtile(TileStore *ts, int t, int32_t seed, int goaltile,
+                     int32_t goalcell, uint32_t *goal) {
+  CacheSlot *sl = xloadtile(ts, t);
+  ts->stats.passes++;
+  int tr = t / ts->tcols, tc = t % ts->tcols;
+  int r0 = tr * ts->tile, c0 = tc * ts->tile;
+  int height = ts->height - r0 < ts->tile ? ts->height - r0 : ts->tile;
+  int width = ts->width - c0 < ts->tile ? ts->width - c0 : ts->tile;
+
+  // The pending costs join the queue in order, each once the queue reaches
+  // it, as the keys in the ring must stay within MAXRISK of each other.
+  PendingList in = ts->pending[t];
+  ts->pending[t] = (PendingList){0};
+  ts->cheapest[t] = UNREACHED;
+  // From here on, (from) is what the cell would cost.
+  for (size_t k = 0; k < in.len; k++) {
+    in.xs[k].from += sl->risk[in.xs[k].cell];
+  }
+  if (in.len) {
+    qsort(in.xs, in.len, sizeof(Pending), cmppending);
+  }
+  if (seed >= 0) {
+    sl->cost[seed] = 0;
+    sl->dirty = true;
+    pushcell(&ts->q[0], seed);
+  }
+
+  size_t next = 0;
+  long queued = seed >= 0 ? 1 : 0;
+  uint32_t d = seed >= 0 ? 0 : in.len ? in.xs[0].from : 0;
+  for (; queued || next < in.len; d++) {
+    if (!queued && in.xs[next].from > d) {
+      d = in.xs[next].from;
+    }
+    for (; next < in.len && in.xs[next].from == d; next++) {
+      int32_t i = in.xs[next].cell;
+      if (d < sl->cost[i]) {
+        sl->cost[i] = d;
+        sl->dirty = true;
+        pushcell(&ts->q[d % (MAXRISK + 1)], i);
+        queued++;
+      }
+    }
+    CellList *b = &ts->q[d % (MAXRISK + 1)];
+    for (size_t k = 0; k < b->len; k++) {
+      int32_t i = b->xs[k];
+      queued--;
+      if (sl->cost[i] != d) {
+        continue;
+      }
+      if (t == goaltile && i == goalcell && d < *goal) {
+        *goal = d;
+      }
+      int r = i / ts->tile, c = i % ts->tile;
+      for (int n = 0; n < 4; n++) {
+        int rn = r + n4rows[n], cn = c + n4cols[n];
+        if (rn >= 0 && rn < height && cn >= 0 && cn < width) {
+          int32_t j = rn * ts->tile + cn;
+          uint32_t x = d + sl->risk[j];
+          if (x < sl->cost[j]) {
+            sl->cost[j] = x;
+            sl->dirty = true;
+            pushcell(&ts->q[x % (MAXRISK + 1)], j);
+            queued++;
+          }
+          continue;
+        }
+        // Across the border, if the map goes on.
+        int gr = r0 + rn, gc = c0 + cn;
+        if (gr < 0 || gr >= ts->height || gc < 0 || gc >= ts->width) {
+          continue;
+        }
+        int u = gr / ts->tile * ts->tcols + gc / ts->tile;
+        sendpending(ts, u, gr % ts->tile * ts->tile + gc % ts->tile, d);
+      }
+    }
+    b->len = 0;
+  }
+  free(in.xs);
+}
+
+// The tile to work through next: the cheapest pending, or a cached one
+// nearly as cheap. Return -1 if none is left below (limit).
+static int picktile(TileStore *ts, uint32_t limit) {
+  // Drop stale entries from the top.
+  while (ts->heap.len) {
+    TileKey top = ts->heap.xs[0];
+    if (ts->cheapest[top.tile] == top.key) {
+      break;
+    }
+    poptile(&ts->heap);
+  }
+  if (!ts->heap.len || ts->heap.xs[0].key >= limit) {
+    return -1;
+  }
+  uint32_t low = ts->heap.xs[0].key;
+  int best = ts->heap.xs[0].tile;
+  if (ts->where[best] >= 0) {
+    return best;
+  }
+  for (int k = 0; k < ts->nslots; k++) {
+    int t = ts->slots[k].tile;
+    if (t >= 0 && ts->cheapest[t] <= low + SLACK && ts->cheapest[t] < limit &&
+        (ts->where[best] < 0 || ts->cheapest[t] < ts->cheapest[best])) {
+      best = t;
+    }
+  }
+  return best;
+}
+
+uint32_t xsolvetiles(TileStore *ts, int sr, int sc, int gr, int gc) {
+  // Forget any earlier solve: costs never written back read as UNREACHED.
+  int ntiles = ts->trows * ts->tcols;
+  memset(ts->stored, 0, ntiles * sizeof(bool));
+  for (int k = 0; k < ts->nslots; k++) {
+    memset(ts->slots[k].cost, 0xff, ts->area * sizeof(uint32_t));
+    ts->slots[k].dirty = false;
+  }
+  for (int t = 0; t < ntiles; t++) {
+    ts->pending[t].len = 0;
+  }
+  memset(ts->cheapest, 0xff, ntiles * sizeof(uint32_t));
+  ts->heap.len = 0;
+  ts->stats = (TileStats){0};
+
+  int start = sr / ts->tile * ts->tcols + sc / ts->tile;
+  int goaltile = gr / ts->tile * ts->tcols + gc / ts->tile;
+  int32_t goalcell = gr % ts->tile * ts->tile + gc % ts->tile;
+  uint32_t goal = UNREACHED;
+  passtile(ts, start, sr % ts->tile * ts->tile + sc % ts->tile, goaltile,
+           goalcell, &goal);
+  // A pending cost at least that of the goal cannot lower it.
+  for (int t; (t = picktile(ts, goal)) >= 0;) {
+    passtile(ts, t, -1, goaltile, goalcell, &goal);
+  }
+  dbgprintf("Tile store: %ld passes, %ld loads, %ld writebacks\n",
+            ts->stats.passes, ts->stats.loads, ts->stats.writebacks);
+  return goal;
+}
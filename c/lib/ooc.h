@@ -0,0 +1,41 @@
+#ifndef OOC_H
+#define OOC_H
+#include <stdint.h>
+
+// Out-of-core shortest paths on a risk map (day 15) too big for memory. The
+// map lives in a file of (tile) by (tile) square tiles, each its risks and
+// then the costs found for them so far, and at most (cache) tiles are in
+// memory at once: the least recently used is written back and dropped when
+// another is needed.
+//
+// The solver works a tile at a time. It takes the tile with the cheapest
+// costs pending from its neighbors, runs Dial's algorithm inside it, and
+// queues what crosses its borders for the neighbors, until nothing pending
+// could still lower the cost of the goal. Preferring the cached tiles among
+// those about as cheap keeps reloads down.
+typedef struct tilestore_t TileStore;
+
+// Counted from the start of the last solve.
+typedef struct {
+  long hits, loads, writebacks; // of tiles
+  long passes;                  // tiles worked through
+  uint64_t bytesread, byteswritten;
+} TileStats;
+
+// Lay out the digit grid in the file at (map), or on standard input if NULL,
+// in tiles in a new file at (path), or an unnamed temporary file if NULL.
+// The map may be a pack (see pack.h) or lines of text; only (tile) rows of it
+// are in memory at a time. Abort on failure.
+TileStore *xmktilestore(char const *map, char const *path, int tile,
+                        int cache);
+
+void tilemapsize(TileStore const *ts, int *width, int *height);
+
+// The cost of the cheapest path from (sr, sc) to (gr, gc). Abort on failure.
+uint32_t xsolvetiles(TileStore *ts, int sr, int sc, int gr, int gc);
+
+TileStats tilestats(TileStore const *ts);
+
+// Close and free the store. A temporary file goes away with it.
+void closetilestore(TileStore *ts);
+#endif
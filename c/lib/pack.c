@@ -0,0 +1,158 @@
+#include "xalloc.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "pack.h"
+
+#define FILEHEADER 16
+#define SECTIONHEADER 24
+
+static uint64_t getle(unsigned char const *p, int nbytes) {
+  uint64_t x = 0;
+  for (int i = nbytes - 1; i >= 0; i--) {
+    x = x << 8 | p[i];
+  }
+  return x;
+}
+
+static void putle(unsigned char *p, uint64_t x, int nbytes) {
+  for (int i = 0; i < nbytes; i++) {
+    p[i] = x >> (8 * i);
+  }
+}
+
+// Round up to a multiple of 8.
+static size_t pad8(size_t n) { return (n + 7) & ~(size_t)7; }
+
+static _Noreturn void badpack(char const *why) {
+  fprintf(stderr, "xloadpack: %s\n", why);
+  abort();
+}
+
+size_t packsize(PackType type) {
+  switch (type) {
+  case PACK_U8:
+    return 1;
+  case PACK_I32:
+    return 4;
+  }
+  return 0;
+}
+
+bool ispack(Input const *in) {
+  return in->len >= FILEHEADER &&
+         memcmp(in->buf, PACKMAGIC, sizeof(PACKMAGIC) - 1) == 0;
+}
+
+Pack *xloadpack(Input *in) {
+  if (!ispack(in)) {
+    badpack("not a pack");
+  }
+  unsigned char *p = (unsigned char *)in->buf;
+  size_t n = getle(p + 8, 4);
+  Pack *pk = xmalloc(sizeof(Pack));
+  *pk = (Pack){.in = in,
+               .nsections = n,
+               .sections = xcalloc(n ? n : 1, sizeof(PackSection))};
+
+  size_t off = FILEHEADER;
+  for (size_t i = 0; i < n; i++) {
+    if (in->len - off < SECTIONHEADER) {
+      badpack("truncated section header");
+    }
+    PackSection *s = &pk->sections[i];
+    s->type = getle(p + off, 4);
+    s->rows = getle(p + off + 8, 8);
+    s->cols = getle(p + off + 16, 8);
+    off += SECTIONHEADER;
+    size_t size = packsize(s->type);
+    if (!size) {
+      badpack("unknown element type");
+    }
+    if (s->cols && s->rows > (in->len - off) / s->cols / size) {
+      badpack("truncated payload");
+    }
+    size_t bytes = s->rows * s->cols * size;
+    s->data = p + off;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    if (s->type == PACK_I32) {
+      uint32_t *xs = s->data;
+      for (size_t j = 0; j < s->rows * s->cols; j++) {
+        xs[j] = __builtin_bswap32(xs[j]);
+      }
+    }
+#endif
+    off += bytes;
+    // The last payload may stop short of its padding.
+    off = pad8(off) < in->len ? pad8(off) : in->len;
+  }
+  return pk;
+}
+
+PackSection *xpacksection(Pack *pk, size_t i, PackType type) {
+  if (i >= pk->nsections) {
+    fprintf(stderr, "xpacksection: no section %zu\n", i);
+    abort();
+  }
+  if (pk->sections[i].type != type) {
+    fprintf(stderr, "xpacksection: section %zu has type %d, not %d\n", i,
+            pk->sections[i].type, type);
+    abort();
+  }
+  return &pk->sections[i];
+}
+
+void closepack(Pack *pk) {
+  closeinput(pk->in);
+  free(pk->sections);
+  free(pk);
+}
+
+static void xwrite(FILE *f, void const *p, size_t n) {
+  if (fwrite(p, 1, n, f) != n) {
+    perror("xwritepack: fwrite");
+    abort();
+  }
+}
+
+// Write the elements of (s) in little-endian order. Return the bytes written.
+static size_t writepayload(FILE *f, PackSection const *s) {
+  size_t count = s->rows * s->cols;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  if (s->type == PACK_I32) {
+    uint32_t const *xs = s->data;
+    for (size_t j = 0; j < count; j++) {
+      unsigned char buf[4];
+      putle(buf, xs[j], 4);
+      xwrite(f, buf, 4);
+    }
+    return count * 4;
+  }
+#endif
+  xwrite(f, s->data, count * packsize(s->type));
+  return count * packsize(s->type);
+}
+
+void xwritepack(FILE *f, PackSection const *sections, size_t n) {
+  unsigned char head[SECTIONHEADER] = {0};
+  memcpy(head, PACKMAGIC, sizeof(PACKMAGIC) - 1);
+  putle(head + 8, n, 4);
+  xwrite(f, head, FILEHEADER);
+
+  for (size_t i = 0; i < n; i++) {
+    PackSection const *s = &sections[i];
+    memset(head, 0, sizeof(head));
+    putle(head, s->type, 4);
+    putle(head + 8, s->rows, 8);
+    putle(head + 16, s->cols, 8);
+    xwrite(f, head, SECTIONHEADER);
+
+    size_t bytes = writepayload(f, s);
+    static unsigned char const zeros[8];
+    xwrite(f, zeros, pad8(bytes) - bytes);
+  }
+  if (fflush(f)) {
+    perror("xwritepack: fflush");
+    abort();
+  }
+}
@@ -0,0 +1,56 @@
+#ifndef PACK_H
+#define PACK_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "input.h"
+
+// A preparsed input: a file header followed by sections, each a header and a
+// raw little-endian row-major payload.
+//
+//   file header     "AOCPACK1", u32 number of sections, u32 zero
+//   section header  u32 element type, u32 zero, u64 rows, u64 columns
+//   payload         rows * columns elements, zero-padded to 8 bytes
+//
+// Every payload starts 8-byte aligned, so a mapped file is used in place.
+#define PACKMAGIC "AOCPACK1"
+
+typedef enum {
+  PACK_U8 = 1,  // uint8_t, e.g. a grid of digit values (not characters)
+  PACK_I32 = 2, // int32_t, e.g. coordinate pairs, one pair per row
+} PackType;
+
+typedef struct {
+  PackType type;
+  size_t rows, cols;
+  void *data;
+} PackSection;
+
+// A loaded pack. Section data points into the input buffer, which is private
+// to this process, so solvers may modify it in place.
+typedef struct {
+  Input *in;
+  size_t nsections;
+  PackSection *sections;
+} Pack;
+
+// True if the input starts with the pack magic.
+bool ispack(Input const *in);
+
+// Take over (in) and index its sections. Abort if it is malformed.
+Pack *xloadpack(Input *in);
+
+// Section (i), which must exist and hold elements of (type), or abort.
+PackSection *xpacksection(Pack *pk, size_t i, PackType type);
+
+// Release the pack and its input.
+void closepack(Pack *pk);
+
+// Size in bytes of one element of (type).
+size_t packsize(PackType type);
+
+// Write (n) sections to (f) in the format above. Abort on failure.
+void xwritepack(FILE *f, PackSection const *sections, size_t n);
+#endif
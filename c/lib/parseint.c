@@ -0,0 +1,212 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "parseint.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PARSEINT_X86 1
+#endif
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define PARSEINT_SWAR 1
+#endif
+
+static uint64_t const pow10s[9] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+};
+
+static inline int isdigitc(char c) { return (unsigned char)(c - '0') < 10; }
+
+#ifdef PARSEINT_SWAR
+// Number of leading digit bytes (in memory order) among the 8 bytes of v.
+static inline unsigned digitrun8(uint64_t v) {
+  uint64_t x = v ^ 0x3030303030303030ull;
+  // A byte is a digit iff x is at most 9 there, that is, iff neither x nor
+  // x + 6 has anything in the high nibble. A carry out of a non-digit byte
+  // only spoils the bytes after it, which are past the run anyway.
+  uint64_t m = (x | (x + 0x0606060606060606ull)) & 0xf0f0f0f0f0f0f0f0ull;
+  return m ? __builtin_ctzll(m) / 8 : 8;
+}
+
+// Combine eight digit values, the first (most significant) in the low byte.
+static inline uint64_t swar8(uint64_t x) {
+  x = ((x & 0x0f0f0f0f0f0f0f0full) * (10 * 256 + 1)) >> 8;
+  x = ((x & 0x00ff00ff00ff00ffull) * (100 * 65536 + 1)) >> 16;
+  return ((x & 0x0000ffff0000ffffull) * (10000 * (1ull << 32) + 1)) >> 32;
+}
+#endif
+
+long parselong(char const **pp, char const *end) {
+  char const *p = *pp;
+  int neg = 0;
+  if (p < end && *p == '-') {
+    neg = 1;
+    p++;
+  }
+  uint64_t val = 0;
+#ifdef PARSEINT_SWAR
+  while (end - p >= 8) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    unsigned n = digitrun8(v);
+    if (!n) {
+      goto done;
+    }
+    // Push the digits to the top so the bytes below read as leading zeros.
+    uint64_t x = (v ^ 0x3030303030303030ull) << (8 * (8 - n));
+    val = val * pow10s[n] + swar8(x);
+    p += n;
+    if (n < 8) {
+      goto done;
+    }
+  }
+#endif
+  for (; p < end && isdigitc(*p); p++) {
+    val = val * 10 + (*p - '0');
+  }
+#ifdef PARSEINT_SWAR
+done:
+#endif
+  *pp = p;
+  return neg ? -(long)val : (long)val;
+}
+
+// Move over separators. Return nonzero if a number starts at *pp; otherwise
+// *pp is where the block ends.
+static inline int skipsep(char const **pp, char const *end) {
+  char const *p = *pp;
+  for (; p < end; p++) {
+    char c = *p;
+    if (isdigitc(c) || c == '-') {
+      *pp = p;
+      return 1;
+    }
+    if (c == '\n') {
+      if (p + 1 < end && p[1] == '\n') {
+        break;
+      }
+    } else if (c != ',' && c != ' ' && c != '\r') {
+      break;
+    }
+  }
+  *pp = p;
+  return 0;
+}
+
+size_t parselongs_swar(char const **pp, char const *end, long *out,
+                       size_t cap) {
+  size_t n = 0;
+  while (n < cap && skipsep(pp, end)) {
+    out[n++] = parselong(pp, end);
+  }
+  return n;
+}
+
+#if defined(PARSEINT_X86) && defined(PARSEINT_SWAR)
+// Byte classes of a 32-byte window, one bit per byte.
+typedef struct {
+  uint32_t digit, minus, newline, ok;
+} Classes;
+
+static inline uint32_t movemask32(__m128i lo, __m128i hi) {
+  return (uint32_t)_mm_movemask_epi8(lo) |
+         ((uint32_t)_mm_movemask_epi8(hi) << 16);
+}
+
+static inline Classes classify32(char const *p) {
+  __m128i const zero = _mm_set1_epi8('0');
+  __m128i const nine = _mm_set1_epi8(9);
+  __m128i c[2], dig[2], minus[2], nl[2], sep[2];
+  for (int i = 0; i < 2; i++) {
+    c[i] = _mm_loadu_si128((__m128i const *)(p + 16 * i));
+    __m128i t = _mm_sub_epi8(c[i], zero);
+    // Digits are exactly the bytes that are (unsigned) at most 9.
+    dig[i] = _mm_cmpeq_epi8(_mm_min_epu8(t, nine), t);
+    minus[i] = _mm_cmpeq_epi8(c[i], _mm_set1_epi8('-'));
+    nl[i] = _mm_cmpeq_epi8(c[i], _mm_set1_epi8('\n'));
+    sep[i] = _mm_or_si128(
+        _mm_or_si128(nl[i], _mm_cmpeq_epi8(c[i], _mm_set1_epi8(','))),
+        _mm_or_si128(_mm_cmpeq_epi8(c[i], _mm_set1_epi8(' ')),
+                     _mm_cmpeq_epi8(c[i], _mm_set1_epi8('\r'))));
+  }
+  Classes k = {.digit = movemask32(dig[0], dig[1]),
+               .minus = movemask32(minus[0], minus[1]),
+               .newline = movemask32(nl[0], nl[1]),
+               .ok = movemask32(_mm_or_si128(sep[0], minus[0]),
+                                _mm_or_si128(sep[1], minus[1]))};
+  k.ok |= k.digit;
+  return k;
+}
+
+// Classify 32 bytes at a time with SSE2, then pick every number that lies
+// wholly inside the window out of the bit masks and convert it with SWAR.
+// Unlike parselong(), the position of the next number comes from the masks
+// rather than from the end of the previous one, so consecutive conversions
+// do not wait on each other.
+static size_t parselongs_sse2(char const **pp, char const *end, long *out,
+                              size_t cap) {
+  size_t n = 0;
+  char const *p = *pp;
+  while (n < cap && end - p >= 32) {
+    Classes k = classify32(p);
+    // A byte that cannot appear in the block, or the first of two newlines,
+    // ends the block.
+    uint32_t blank = k.newline & (k.newline >> 1);
+    if ((k.newline >> 31) && end - p > 32 && p[32] == '\n') {
+      blank |= (uint32_t)1 << 31;
+    }
+    uint32_t stop = ~k.ok | blank;
+    unsigned limit = stop ? __builtin_ctz(stop) : 32;
+    uint32_t inside = limit == 32 ? ~(uint32_t)0 : ((uint32_t)1 << limit) - 1;
+    uint32_t starts = k.digit & ~(k.digit << 1) & inside;
+    // Where the next window starts: past this one, unless an item is cut off.
+    unsigned next = (k.minus >> 31) && limit == 32 ? 31 : 32;
+
+    for (; starts && n < cap; starts &= starts - 1) {
+      unsigned s = __builtin_ctz(starts);
+      unsigned len = __builtin_ctz(~(k.digit >> s));
+      unsigned neg = s > 0 && ((k.minus >> (s - 1)) & 1);
+      if (s + len == 32 && limit == 32) {
+        next = s - neg;
+        break;
+      }
+      if (len <= 8 && end - (p + s) >= 8) {
+        uint64_t v;
+        memcpy(&v, p + s, 8);
+        long val = (long)swar8((v ^ 0x3030303030303030ull) << (8 * (8 - len)));
+        out[n++] = neg ? -val : val;
+      } else {
+        char const *q = p + s;
+        out[n++] = neg ? -parselong(&q, end) : parselong(&q, end);
+      }
+      if (n == cap) {
+        *pp = p + s + len;
+        return n;
+      }
+    }
+
+    if (limit < 32) {
+      p += limit;
+      break;
+    }
+    if (next == 0) {
+      // A number longer than the window: leave it to parselong().
+      out[n++] = parselong(&p, end);
+      continue;
+    }
+    p += next;
+  }
+  *pp = p;
+  // The tail (or whatever stopped the block) goes through the SWAR path.
+  return n + parselongs_swar(pp, end, out + n, cap - n);
+}
+#endif
+
+size_t parselongs(char const **pp, char const *end, long *out, size_t cap) {
+#if defined(PARSEINT_X86) && defined(PARSEINT_SWAR)
+  return parselongs_sse2(pp, end, out, cap);
+#else
+  return parselongs_swar(pp, end, out, cap);
+#endif
+}
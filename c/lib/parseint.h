@@ -0,0 +1,26 @@
+#ifndef PARSEINT_H
+#define PARSEINT_H
+#include <stddef.h>
+
+// Parse one optionally negative decimal integer starting exactly at *pp
+// (no leading blanks) and ending before (end). Eight digits are converted at a
+// time with SWAR arithmetic. On return *pp points just past the last digit.
+// Digits are assumed to fit in a long.
+long parselong(char const **pp, char const *end);
+
+// Parse a block of decimal integers separated by ',', ' ', '\r' or '\n' into
+// out, at most (cap) of them, and return how many were stored. The block ends
+// at a blank line, at any other character, or at (end); *pp is left there
+// (or past the last number stored, if out fills up first), so a caller can
+// resume with another call or go on to parse whatever follows the block.
+//
+// On x86 the bytes are classified 32 at a time with SSE2 and every number
+// found in the window is converted with SWAR; elsewhere (and for the last few
+// bytes of the buffer) numbers go one by one through parselong(). A '-' must
+// be followed by a digit.
+size_t parselongs(char const **pp, char const *end, long *out, size_t cap);
+
+// Same as parselongs(), but always on the SWAR path. For benchmarks.
+size_t parselongs_swar(char const **pp, char const *end, long *out,
+                       size_t cap);
+#endif
@@ -0,0 +1,142 @@
+#include "xalloc.h"
+#include <errno.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "boldprint.h"
+#include "render.h"
+
+// Initial buffer size; large enough for most frames.
+#define FRAMEBUF (1 << 16)
+
+Frame *xmkframe(FILE *out) {
+  Frame *f = xmalloc(sizeof(Frame));
+  *f = (Frame){.out = out,
+               .buf = xmalloc(FRAMEBUF),
+               .len = 0,
+               .cap = FRAMEBUF,
+               .tty = isatty(fileno(out)),
+               .style = STYLE_NORMAL};
+  return f;
+}
+
+Frame *xmkdbgframe(void) {
+#ifndef NDEBUG
+  return xmkframe(stderr);
+#else
+  return NULL;
+#endif
+}
+
+void freeframe(Frame *f) {
+  if (!f) {
+    return;
+  }
+  free(f->buf);
+  free(f);
+}
+
+void xreserveframe(Frame *f, size_t n) {
+  if (!f || f->cap - f->len >= n) {
+    return;
+  }
+  while (f->cap - f->len < n) {
+    f->cap *= 2;
+  }
+  f->buf = xrealloc(f->buf, f->cap);
+}
+
+static void framebytes(Frame *f, char const *s, size_t n) {
+  xreserveframe(f, n);
+  memcpy(f->buf + f->len, s, n);
+  f->len += n;
+}
+
+void framestyle(Frame *f, Style s) {
+  if (!f || f->style == s) {
+    return;
+  }
+  f->style = s;
+  char const *esc = s == STYLE_BOLD ? TEXTBOLD(f->tty) : TEXTNORMAL(f->tty);
+  framebytes(f, esc, strlen(esc));
+}
+
+void frameputs(Frame *f, char const *s) {
+  if (f) {
+    framebytes(f, s, strlen(s));
+  }
+}
+
+void frameint(Frame *f, long v, int width) {
+  if (!f) {
+    return;
+  }
+  char digits[24];
+  int n = 0;
+  unsigned long u = v < 0 ? -(unsigned long)v : (unsigned long)v;
+  do {
+    digits[n++] = '0' + u % 10;
+    u /= 10;
+  } while (u);
+  if (v < 0) {
+    digits[n++] = '-';
+  }
+  int pad = width > n ? width - n : 0;
+  xreserveframe(f, pad + n);
+  memset(f->buf + f->len, ' ', pad);
+  f->len += pad;
+  while (n) {
+    f->buf[f->len++] = digits[--n];
+  }
+}
+
+void frameprintf(Frame *f, char const *fmt, ...) {
+  if (!f) {
+    return;
+  }
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(f->buf + f->len, f->cap - f->len, fmt, ap);
+  va_end(ap);
+  if (n >= 0 && (size_t)n >= f->cap - f->len) {
+    // Did not fit: grow and format again.
+    xreserveframe(f, n + 1);
+    va_start(ap, fmt);
+    vsnprintf(f->buf + f->len, f->cap - f->len, fmt, ap);
+    va_end(ap);
+  }
+  f->len += n > 0 ? n : 0;
+}
+
+void framebits(Frame *f, uint64_t const *ws, size_t n, char on, char off) {
+  if (!f) {
+    return;
+  }
+  xreserveframe(f, n);
+  char *p = f->buf + f->len;
+  for (size_t i = 0; i < n; i++) {
+    p[i] = (ws[i / 64] >> (i % 64)) & 1 ? on : off;
+  }
+  f->len += n;
+}
+
+void flushframe(Frame *f) {
+  if (!f) {
+    return;
+  }
+  framestyle(f, STYLE_NORMAL);
+  fflush(f->out);
+  int fd = fileno(f->out);
+  size_t done = 0;
+  while (done < f->len) {
+    ssize_t n = write(fd, f->buf + done, f->len - done);
+    if (n < 0 && errno != EINTR) {
+      perror("flushframe: write");
+      abort();
+    }
+    done += n > 0 ? n : 0;
+  }
+  f->len = 0;
+}
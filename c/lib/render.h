@@ -0,0 +1,65 @@
+#ifndef RENDER_H
+#define RENDER_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef enum {
+  STYLE_NORMAL,
+  STYLE_BOLD,
+} Style;
+
+// A frame of text built up in a reusable buffer and written out with a single
+// write() when flushed. Styles are tracked across cells, so a run of cells in
+// the same style costs one escape sequence, and none at all unless the output
+// is a terminal (see boldprint.h).
+//
+// Every function below accepts a NULL frame and does nothing with it.
+typedef struct {
+  FILE *out;
+  char *buf;
+  size_t len, cap;
+  bool tty;
+  Style style;
+} Frame;
+
+// A frame that flushes to (out). Abort on failure.
+Frame *xmkframe(FILE *out);
+
+// A frame on stderr for debug output, or NULL under NDEBUG.
+Frame *xmkdbgframe(void);
+
+void freeframe(Frame *f);
+
+// Make room for (n) more bytes. Abort on failure.
+void xreserveframe(Frame *f, size_t n);
+
+static inline void framechar(Frame *f, char c) {
+  if (!f) {
+    return;
+  }
+  if (f->len == f->cap) {
+    xreserveframe(f, 1);
+  }
+  f->buf[f->len++] = c;
+}
+
+// Switch to (s), if the frame is not in it already.
+void framestyle(Frame *f, Style s);
+
+void frameputs(Frame *f, char const *s);
+
+// (v) in decimal, right-aligned in (width) columns.
+void frameint(Frame *f, long v, int width);
+
+__attribute__((format(printf, 2, 3))) void frameprintf(Frame *f,
+                                                       char const *fmt, ...);
+
+// Bits [0, n) of (ws) as (on) and (off) characters.
+void framebits(Frame *f, uint64_t const *ws, size_t n, char on, char off);
+
+// Return to the normal style, flush (out) so earlier stdio output comes
+// first, and write the frame out. The buffer is kept for the next frame.
+void flushframe(Frame *f);
+#endif
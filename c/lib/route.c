@@ -0,0 +1,122 @@
+#include "xalloc.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "dbgprint.h"
+#include "route.h"
+
+Router xmkrouter(RiskMap const *m, int capacity) {
+  return (Router){
+      .m = m,
+      .trees = xcalloc(capacity ? capacity : 1, sizeof(RouteTree)),
+      .capacity = capacity,
+      .ghosts = xcalloc(capacity ? GHOSTS * capacity : 1, sizeof(ptrdiff_t)),
+  };
+}
+
+void freerouter(Router *rt) {
+  for (int k = 0; k < rt->ntrees; k++) {
+    delete_solution(rt->trees[k].s);
+  }
+  free(rt->trees);
+  free(rt->ghosts);
+}
+
+static RouteTree *findtree(Router *rt, ptrdiff_t source) {
+  for (int k = 0; k < rt->ntrees; k++) {
+    if (rt->trees[k].source == source) {
+      return &rt->trees[k];
+    }
+  }
+  return NULL;
+}
+
+// Whether (source) was seen recently; forget it if so.
+static bool takeghost(Router *rt, ptrdiff_t source) {
+  for (int k = 0; k < rt->nghosts; k++) {
+    if (rt->ghosts[k] == source) {
+      rt->ghosts[k] = -1;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void addghost(Router *rt, ptrdiff_t source) {
+  int n = GHOSTS * rt->capacity;
+  if (!n) {
+    return;
+  }
+  rt->ghosts[rt->ghostpos] = source;
+  rt->ghostpos = (rt->ghostpos + 1) % n;
+  if (rt->nghosts < n) {
+    rt->nghosts++;
+  }
+}
+
+// Build the tree of (from) in the least recently used slot.
+static RouteTree *solvetree(Router *rt, Cursor from) {
+  RouteTree *t;
+  if (rt->ntrees < rt->capacity) {
+    t = &rt->trees[rt->ntrees++];
+  } else {
+    t = &rt->trees[0];
+    for (int k = 1; k < rt->ntrees; k++) {
+      if (rt->trees[k].used < t->used) {
+        t = &rt->trees[k];
+      }
+    }
+    dbgprintf("Evicting the tree of (%d, %d)\n",
+              gridrow(&rt->m->shape, t->source),
+              gridcol(&rt->m->shape, t->source));
+    delete_solution(t->s);
+  }
+  t->source = gridindex(&rt->m->shape, PRIcursor(from));
+  t->s = dial_grid(rt->m, PRIcursor(from));
+  rt->solves++;
+  return t;
+}
+
+// A solution that knows the path from (from) to (to): a cached tree, or
+// (*own), which the caller then deletes.
+static Solution const *answer(Router *rt, Cursor from, Cursor to,
+                              Solution *own) {
+  ptrdiff_t source = gridindex(&rt->m->shape, PRIcursor(from));
+  rt->queries++;
+  RouteTree *t = findtree(rt, source);
+  if (t) {
+    rt->hits++;
+  } else if (takeghost(rt, source)) {
+    t = solvetree(rt, from);
+  }
+  if (t) {
+    t->used = rt->queries;
+    return &t->s;
+  }
+  addghost(rt, source);
+  *own = astar_grid(rt->m, PRIcursor(from), PRIcursor(to));
+  return own;
+}
+
+uint32_t routecost(Router *rt, Cursor from, Cursor to) {
+  Solution own = {0};
+  Solution const *s = answer(rt, from, to, &own);
+  uint32_t cost = getcost(s, gridindex(&rt->m->shape, PRIcursor(to)));
+  if (s == &own) {
+    delete_solution(own);
+  }
+  return cost;
+}
+
+long xroutepath(Router *rt, Cursor from, Cursor to, Cursor **path,
+                uint32_t *cost) {
+  Solution own = {0};
+  Solution const *s = answer(rt, from, to, &own);
+  long n = xtracepath(s, PRIcursor(to), path);
+  *cost = getcost(s, gridindex(&rt->m->shape, PRIcursor(to)));
+  if (s == &own) {
+    delete_solution(own);
+  }
+  return n;
+}
@@ -0,0 +1,44 @@
+#ifndef ROUTE_H
+#define ROUTE_H
+#include <stdint.h>
+
+#include "sssp.h"
+
+// A resident query engine for cheapest paths between any two cells of a
+// risk map (see sssp.h). It keeps the complete shortest-path trees of up to
+// (capacity) sources, evicting the least recently used. A source earns a
+// tree the second time it is asked about while it is still among the
+// (GHOSTS * capacity) sources seen most recently; until then, its queries
+// are answered point to point with A*.
+
+#define GHOSTS 4
+
+typedef struct {
+  ptrdiff_t source;
+  Solution s;
+  long used; // the query that used the tree last
+} RouteTree;
+
+typedef struct {
+  RiskMap const *m;
+  RouteTree *trees;
+  int ntrees, capacity;
+  ptrdiff_t *ghosts; // a ring of recent sources without a tree
+  int nghosts, ghostpos;
+  long queries, hits, solves; // solves: trees built
+} Router;
+
+// An engine over (m), which must outlive it. Abort on failure.
+Router xmkrouter(RiskMap const *m, int capacity);
+
+void freerouter(Router *rt);
+
+// The cost of the cheapest path from (from) to (to), or UNREACHED.
+uint32_t routecost(Router *rt, Cursor from, Cursor to);
+
+// The cells of the cheapest path from (from) to (to), in (*path), and its
+// cost, in (*cost). Return their number, or 0 if no path reaches (to). Abort
+// on failure.
+long xroutepath(Router *rt, Cursor from, Cursor to, Cursor **path,
+                uint32_t *cost);
+#endif
@@ -0,0 +1,1208 @@
+#include "xalloc.h"
+#include <assert.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "dbgprint.h"
+#include "sssp.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SSSP_X86 1
+#endif
+
+int const n4rows[4] = {-1, 1, 0, 0};
+int const n4cols[4] = {0, 0, -1, 1};
+
+RiskMap xmkriskmap(Grid const *base, int tiles) {
+  assert(base->halo >= 1 && tiles >= 1);
+  RiskMap m = {.base = base, .tiles = tiles};
+  bool present[MAXRISK + 1] = {false};
+  for_rc(*base, r, c) {
+    int v = *gridat(base, r, c);
+    if (v < (tiles == 1 ? 0 : 1) || v > MAXRISK) {
+      fprintf(stderr, "xmkriskmap: risk %d at (%d, %d) is not in %d..%d\n",
+              v, r, c, tiles == 1 ? 0 : 1, MAXRISK);
+      abort();
+    }
+    present[v] = true;
+  }
+  if (tiles == 1) {
+    m.shape = *base;
+    m.shape.cells = m.shape.base = NULL;
+    m.direct = true;
+    m.minrisk = MAXRISK;
+    for (int v = MAXRISK; v >= 0; v--) {
+      m.minrisk = present[v] ? v : m.minrisk;
+    }
+    return m;
+  }
+  int height = base->height * tiles, width = base->width * tiles;
+  m.shape = gridshape(width, height, 1);
+
+  // The halo rows and columns of the map map to the first row or column of
+  // the base. Their risks are never used (relaxing into the halo never
+  // succeeds), but this keeps every lookup inside the base and inside the
+  // wrap table.
+  m.rowoff = (ptrdiff_t *)xcalloc(height + 2, sizeof(ptrdiff_t)) + 1;
+  m.rowadd = (int *)xcalloc(height + 2, sizeof(int)) + 1;
+  for (int r = -1; r <= height; r++) {
+    int br = r < 0 ? 0 : r % base->height;
+    m.rowoff[r] = gridindex(base, br, 0);
+    m.rowadd[r] = r < 0 ? 0 : r / base->height;
+  }
+  m.coloff = (int *)xcalloc(width + 2, sizeof(int)) + 1;
+  m.coladd = (int *)xcalloc(width + 2, sizeof(int)) + 1;
+  for (int c = -1; c <= width; c++) {
+    m.coloff[c] = c < 0 ? 0 : c % base->width;
+    m.coladd[c] = c < 0 ? 0 : c / base->width;
+  }
+
+  m.wrap = xmalloc(MAXRISK + 1 + 2 * tiles);
+  for (int x = 0; x < MAXRISK + 1 + 2 * tiles; x++) {
+    m.wrap[x] = x ? (x - 1) % MAXRISK + 1 : 0;
+  }
+  // Any risk present in the base shows up raised by 0 to 2 * (tiles - 1).
+  m.minrisk = MAXRISK;
+  for (int v = 1; v <= MAXRISK; v++) {
+    for (int k = 0; present[v] && k <= 2 * (tiles - 1); k++) {
+      m.minrisk = m.wrap[v + k] < m.minrisk ? m.wrap[v + k] : m.minrisk;
+    }
+  }
+  return m;
+}
+
+void freeriskmap(RiskMap m) {
+  if (m.direct) {
+    return;
+  }
+  free(m.rowoff - 1);
+  free(m.rowadd - 1);
+  free(m.coloff - 1);
+  free(m.coladd - 1);
+  free(m.wrap);
+}
+
+bool parsecell(char const *s, Cursor *co) {
+  int n = 0;
+  return sscanf(s, "%d,%d%n", &co->row, &co->column, &n) == 2 && !s[n];
+}
+
+Solution new_solution(Grid const *g, int start_r, int start_c) {
+  bool wide = (long)MAXRISK * (g->width + g->height) >= UINT16_MAX;
+  size_t size = wide ? sizeof(uint32_t) : sizeof(uint16_t);
+  Solution s = {.n = (long)g->width * (long)g->height,
+                .cost = xmkgridlayer(g, size),
+                .pred = xcalloc((gridsize(g) + 3) / 4, 1),
+                .wide = wide,
+                .shape = gridshape(g->width, g->height, g->halo),
+                .start = gridindex(g, start_r, start_c)};
+
+  // All ones is UNREACHED in either width.
+  for (int r = 0; r < g->height; r++) {
+    memset((char *)s.cost + gridindex(g, r, 0) * (ptrdiff_t)size, 0xff,
+           g->width * size);
+  }
+  setcost(&s, s.start, 0);
+  return s;
+}
+
+void delete_solution(Solution s) {
+  freegridlayer(&s.shape, s.cost, s.wide ? sizeof(uint32_t) : sizeof(uint16_t));
+  free(s.pred);
+}
+
+bool walkpath(PathWalk *w, Solution const *s, int r, int c) {
+  *w = (PathWalk){.s = s, .i = gridindex(&s->shape, r, c), .at = cursor(r, c)};
+  return getcost(s, w->i) != UNREACHED;
+}
+
+bool stepback(PathWalk *w) {
+  if (w->i == w->s->start) {
+    return false;
+  }
+  int dir = getpred(w->s, w->i);
+  w->i += gridn4(&w->s->shape).d[dir];
+  w->at = cursor(w->at.row + n4rows[dir], w->at.column + n4cols[dir]);
+  return true;
+}
+
+long xtracepath(Solution const *s, int r, int c, Cursor **path) {
+  PathWalk w;
+  long n = 0;
+  if (walkpath(&w, s, r, c)) {
+    do {
+      n++;
+    } while (stepback(&w));
+  }
+  *path = xcalloc(n ? n : 1, sizeof(Cursor));
+  if (walkpath(&w, s, r, c)) {
+    long k = n;
+    do {
+      (*path)[--k] = w.at;
+    } while (stepback(&w));
+  }
+  return n;
+}
+
+// One bucket of the circular queue: cell indices, in no particular order.
+typedef struct {
+  ptrdiff_t *xs;
+  size_t len, cap;
+} Bucket;
+
+static void pushbucket(Bucket *b, ptrdiff_t i) {
+  if (b->len == b->cap) {
+    b->cap = b->cap ? b->cap * 2 : 64;
+    b->xs = xrealloc(b->xs, b->cap * sizeof(ptrdiff_t));
+  }
+  b->xs[b->len++] = i;
+}
+
+static bool inshape(Grid const *g, int r, int c) {
+  return r >= 0 && r < g->height && c >= 0 && c < g->width;
+}
+
+// Point cell (i), at row (r) and column (c), of risk above 0, at its first
+// neighbor that a shortest path can come from. Return false if there is none.
+static bool pointcell(RiskMap const *m, Solution *s, ptrdiff_t i, int r, int c,
+                      int risk) {
+  Grid const *g = &m->shape;
+  Stencil n4 = gridn4(g);
+  uint32_t cost = getcost(s, i);
+  // A halo cell costs 0 too, so it has to be told apart by position.
+  for (int k = 0; k < n4.n; k++) {
+    uint32_t from = getcost(s, i + n4.d[k]);
+    if (inshape(g, r + n4rows[k], c + n4cols[k]) && from != UNREACHED &&
+        from + risk == cost) {
+      setpred(s, i, k);
+      return true;
+    }
+  }
+  return false;
+}
+
+void canonical_preds(RiskMap const *m, Solution *s, int start_r, int start_c) {
+  Grid const *g = &m->shape;
+  Stencil n4 = gridn4(g);
+  ptrdiff_t start = gridindex(g, start_r, start_c);
+  // Cells pointed at their predecessor (or the start).
+  unsigned char *done = xmkgridlayer(g, 1);
+  done[start] = 1;
+  bool zeros = false;
+  for_rc(*g, r, c) {
+    ptrdiff_t i = gridindex(g, r, c);
+    uint32_t cost = getcost(s, i);
+    setpred(s, i, 0);
+    if (i == start || cost == UNREACHED) {
+      continue;
+    }
+    int risk = riskat(m, i, r, c);
+    if (!risk) {
+      zeros = true;
+      continue;
+    }
+    done[i] = pointcell(m, s, i, r, c, risk);
+  }
+
+  // A cell of risk 0 costs as much as the neighbor it is entered from, which
+  // may be another such cell. Point those breadth-first from the cells
+  // already pointed, so that the predecessors never form a cycle.
+  Bucket q = {0};
+  for_rc(*g, r, c) {
+    ptrdiff_t i = gridindex(g, r, c);
+    if (zeros && done[i]) {
+      pushbucket(&q, i);
+    }
+  }
+  for (size_t k = 0; k < q.len; k++) {
+    ptrdiff_t i = q.xs[k];
+    int r = gridrow(g, i), c = gridcol(g, i);
+    for (int n = 0; n < n4.n; n++) {
+      ptrdiff_t j = i + n4.d[n];
+      int rj = r + n4rows[n], cj = c + n4cols[n];
+      if (inshape(g, rj, cj) && !done[j] && !riskat(m, j, rj, cj) &&
+          getcost(s, j) == getcost(s, i)) {
+        setpred(s, j, oppositedir(n));
+        done[j] = 1;
+        pushbucket(&q, j);
+      }
+    }
+  }
+  free(q.xs);
+  freegridlayer(g, done, 1);
+}
+
+Solution bellman_ford_grid(RiskMap const *m, int start_r, int start_c) {
+  Grid const *g = &m->shape;
+  long n_vertices = (long)g->width * (long)g->height;
+  Solution s = new_solution(g, start_r, start_c);
+
+  static char const *const direction[] = {"Up", "Down", "Left", "Right"};
+  Stencil n4 = gridn4(g);
+
+  for (long repeat = 0; repeat < n_vertices; repeat++) {
+    long n_updates = 0;
+
+    for_rc(*g, r, c) {
+      Cursor co = cursor(r, c);
+      ptrdiff_t i = gridindex(g, r, c);
+      uint32_t here_cost = getcost(&s, i);
+      if (here_cost == UNREACHED) {
+        continue;
+      }
+
+      // Up, down, left, right
+      for (int k = 0; k < n4.n; k++) {
+        ptrdiff_t j = i + n4.d[k];
+        int update = riskat(m, j, r + n4rows[k], c + n4cols[k]);
+        if (here_cost + update < getcost(&s, j)) {
+          dbgprintf("%s from (%d, %d), assign %u (from %u)\n", direction[k],
+                    PRIcursor(co), here_cost + update, getcost(&s, j));
+          n_updates++;
+          setcost(&s, j, here_cost + update);
+          setpred(&s, j, oppositedir(k));
+        }
+      }
+    }
+
+    if (n_updates) {
+      dbgprintf("%ld updates were made.\n", n_updates);
+    } else {
+      dbgprintf("No further updates made in step %ld\n", repeat);
+      break;
+    }
+
+    dbgprintf("Bellman-Ford Generation %ld\n", repeat);
+    dbgprintf("Costs\n");
+    for_rc(*g, r, c) {
+      dbgprintf("(%d, %d) cost = %u, from direction %d\n", r, c,
+                getcost(&s, gridindex(g, r, c)),
+                getpred(&s, gridindex(g, r, c)));
+    }
+  }
+
+  canonical_preds(m, &s, start_r, start_c);
+  return s;
+}
+
+Solution dial_grid(RiskMap const *m, int start_r, int start_c) {
+  Grid const *g = &m->shape;
+  Solution s = new_solution(g, start_r, start_c);
+  Stencil n4 = gridn4(g);
+  Bucket q[MAXRISK + 1] = {0};
+  pushbucket(&q[0], gridindex(g, start_r, start_c));
+  long pending = 1;
+
+  // Every cell in the frontier costs at most MAXRISK more than the cheapest,
+  // so bucket d % (MAXRISK + 1) holds exactly the cells of cost d.
+  for (uint32_t d = 0; pending; d++) {
+    Bucket *b = &q[d % (MAXRISK + 1)];
+    // A risk of 0 lands in the bucket being drained, so it may grow.
+    for (size_t k = 0; k < b->len; k++) {
+      ptrdiff_t i = b->xs[k];
+      pending--;
+      if (getcost(&s, i) != d) {
+        // Stale: the cell was reached more cheaply since, and settled then.
+        continue;
+      }
+      // Only a tiled map needs the row and column.
+      int r = 0, c = 0;
+      if (!m->direct) {
+        r = gridrow(g, i);
+        c = gridcol(g, i);
+      }
+      for (int n = 0; n < n4.n; n++) {
+        ptrdiff_t j = i + n4.d[n];
+        int w = riskat(m, j, r + n4rows[n], c + n4cols[n]);
+        assert(w >= 0 && w <= MAXRISK);
+        if (d + w < getcost(&s, j)) {
+          setcost(&s, j, d + w);
+          pushbucket(&q[(d + w) % (MAXRISK + 1)], j);
+          pending++;
+        }
+      }
+    }
+    b->len = 0;
+  }
+
+  for (int k = 0; k <= MAXRISK; k++) {
+    free(q[k].xs);
+  }
+  // Predecessors are not tracked above; they follow from the costs.
+  canonical_preds(m, &s, start_r, start_c);
+  return s;
+}
+
+// The alternating sweeps keep costs in unsigned lanes of one of two widths.
+// Narrow lanes saturate at UINT16_MAX; wide lanes stop at INF32, low enough
+// that adding a risk never wraps, so neither needs a branch.
+#define INF32 (UINT32_MAX - MAXRISK)
+
+// A half-open range of columns.
+typedef struct {
+  int lo, hi;
+} Span;
+
+static inline Span joinspan(Span a, Span b) {
+  if (a.lo >= a.hi) {
+    return b;
+  } else if (b.lo >= b.hi) {
+    return a;
+  }
+  return (Span){a.lo < b.lo ? a.lo : b.lo, a.hi > b.hi ? a.hi : b.hi};
+}
+
+// Relax the cells (dst)[lo, hi) of a row from the same cells of the row
+// (src) next to it, where cells enter (dst) at (risk). Return whether
+// anything changed.
+typedef bool (*RelaxRow)(void *restrict dst, void const *restrict src,
+                         unsigned char const *risk, int lo, int hi);
+
+// After the cells [lo, hi) of a row of (n) cells changed, relax the row
+// rightward from lo and leftward from hi - 1, as far as anything changes.
+// Return the span of cells that may have changed.
+typedef Span (*ScanRow)(void *row, unsigned char const *risk, Span s, int n);
+
+typedef struct {
+  size_t size;
+  uint32_t inf;
+  RelaxRow relax;
+  ScanRow scan;
+} Lanes;
+
+static inline uint16_t addsat16(uint16_t x, uint16_t y) {
+  uint16_t z = x + y;
+  return z | -(z < x);
+}
+
+static inline uint16_t min16(uint16_t x, uint16_t y) { return x < y ? x : y; }
+
+static inline uint32_t min32(uint32_t x, uint32_t y) { return x < y ? x : y; }
+
+static bool relaxrow16(void *restrict dst, void const *restrict src,
+                       unsigned char const *risk, int lo, int hi) {
+  uint16_t *d = dst;
+  uint16_t const *s = src;
+  bool changed = false;
+  for (int c = lo; c < hi; c++) {
+    uint16_t x = min16(d[c], addsat16(s[c], risk[c]));
+    changed |= x != d[c];
+    d[c] = x;
+  }
+  return changed;
+}
+
+static bool relaxrow32(void *restrict dst, void const *restrict src,
+                       unsigned char const *risk, int lo, int hi) {
+  uint32_t *d = dst;
+  uint32_t const *s = src;
+  bool changed = false;
+  for (int c = lo; c < hi; c++) {
+    uint32_t x = min32(d[c], s[c] + risk[c]);
+    changed |= x != d[c];
+    d[c] = x;
+  }
+  return changed;
+}
+
+#ifdef SSSP_X86
+__attribute__((target("avx2"))) static bool
+relaxrow16_avx2(void *restrict dst, void const *restrict src,
+                unsigned char const *risk, int lo, int hi) {
+  uint16_t *d = dst;
+  uint16_t const *s = src;
+  __m256i changed = _mm256_setzero_si256();
+  int c = lo;
+  for (; c + 16 <= hi; c += 16) {
+    __m128i bytes = _mm_loadu_si128((__m128i const *)(risk + c));
+    __m256i w = _mm256_cvtepu8_epi16(bytes);
+    __m256i old = _mm256_loadu_si256((__m256i const *)(d + c));
+    __m256i from = _mm256_loadu_si256((__m256i const *)(s + c));
+    __m256i x = _mm256_min_epu16(old, _mm256_adds_epu16(from, w));
+    changed = _mm256_or_si256(changed, _mm256_xor_si256(x, old));
+    _mm256_storeu_si256((__m256i *)(d + c), x);
+  }
+  return !_mm256_testz_si256(changed, changed) | relaxrow16(d, s, risk, c, hi);
+}
+
+__attribute__((target("avx2"))) static bool
+relaxrow32_avx2(void *restrict dst, void const *restrict src,
+                unsigned char const *risk, int lo, int hi) {
+  uint32_t *d = dst;
+  uint32_t const *s = src;
+  __m256i changed = _mm256_setzero_si256();
+  int c = lo;
+  for (; c + 8 <= hi; c += 8) {
+    __m128i bytes = _mm_loadl_epi64((__m128i const *)(risk + c));
+    __m256i w = _mm256_cvtepu8_epi32(bytes);
+    __m256i old = _mm256_loadu_si256((__m256i const *)(d + c));
+    __m256i from = _mm256_loadu_si256((__m256i const *)(s + c));
+    __m256i x = _mm256_min_epu32(old, _mm256_add_epi32(from, w));
+    changed = _mm256_or_si256(changed, _mm256_xor_si256(x, old));
+    _mm256_storeu_si256((__m256i *)(d + c), x);
+  }
+  return !_mm256_testz_si256(changed, changed) | relaxrow32(d, s, risk, c, hi);
+}
+#endif
+
+// Along a row each cell depends on the one just before it, so the scans stay
+// scalar. Past the changed span, they stop at the first cell that keeps its
+// cost: the cells beyond it were consistent with it already.
+static Span scanrow16(void *row, unsigned char const *risk, Span s, int n) {
+  uint16_t *d = row;
+  int c = s.lo + 1;
+  for (; c < n; c++) {
+    uint16_t x = min16(d[c], addsat16(d[c - 1], risk[c]));
+    if (x == d[c] && c >= s.hi) {
+      break;
+    }
+    d[c] = x;
+  }
+  int b = s.hi - 2;
+  for (; b >= 0; b--) {
+    uint16_t x = min16(d[b], addsat16(d[b + 1], risk[b]));
+    if (x == d[b] && b < s.lo) {
+      break;
+    }
+    d[b] = x;
+  }
+  return (Span){b + 1, c};
+}
+
+static Span scanrow32(void *row, unsigned char const *risk, Span s, int n) {
+  uint32_t *d = row;
+  int c = s.lo + 1;
+  for (; c < n; c++) {
+    uint32_t x = min32(d[c], d[c - 1] + risk[c]);
+    if (x == d[c] && c >= s.hi) {
+      break;
+    }
+    d[c] = x;
+  }
+  int b = s.hi - 2;
+  for (; b >= 0; b--) {
+    uint32_t x = min32(d[b], d[b + 1] + risk[b]);
+    if (x == d[b] && b < s.lo) {
+      break;
+    }
+    d[b] = x;
+  }
+  return (Span){b + 1, c};
+}
+
+// The risks of row (r) of the map, as bytes: the base row itself if the map
+// is direct, else gathered into (buf).
+static unsigned char const *riskrow(RiskMap const *m, int r,
+                                    unsigned char *buf) {
+  if (m->direct) {
+    return (unsigned char const *)gridat(m->base, r, 0);
+  }
+  for (int c = 0; c < m->shape.width; c++) {
+    buf[c] = riskat(m, 0, r, c);
+  }
+  return buf;
+}
+
+// The columns of each row that changed since the row below (down) or above
+// (up) was last relaxed from it. The halo rows never change.
+typedef struct {
+  Span *down, *up;
+} Pending;
+
+// Relax row (r) from the row (r + dr) over the columns that changed there,
+// and scan it. Return whether row (r) changed.
+static bool sweeprow(RiskMap const *m, Lanes const *ln, char *cost,
+                     unsigned char *buf, Pending *p, int r, int dr) {
+  Span *from = dr < 0 ? &p->down[r + dr] : &p->up[r + dr];
+  Span s = *from;
+  if (s.lo >= s.hi) {
+    return false;
+  }
+  *from = (Span){0, 0};
+  Grid const *g = &m->shape;
+  char *row = cost + gridindex(g, r, 0) * (ptrdiff_t)ln->size;
+  char *src = row + dr * (ptrdiff_t)(g->stride * ln->size);
+  unsigned char const *risk = riskrow(m, r, buf);
+  if (!ln->relax(row, src, risk, s.lo, s.hi)) {
+    return false;
+  }
+  s = joinspan(s, ln->scan(row, risk, s, g->width));
+  p->down[r] = joinspan(p->down[r], s);
+  p->up[r] = joinspan(p->up[r], s);
+  return true;
+}
+
+// One downward and one upward sweep over the rows. Return whether anything
+// changed.
+static bool sweep(RiskMap const *m, Lanes const *ln, char *cost,
+                  unsigned char *buf, Pending *p) {
+  Grid const *g = &m->shape;
+  bool changed = false;
+  for (int r = 1; r < g->height; r++) {
+    changed |= sweeprow(m, ln, cost, buf, p, r, -1);
+  }
+  for (int r = g->height - 2; r >= 0; r--) {
+    changed |= sweeprow(m, ln, cost, buf, p, r, 1);
+  }
+  return changed;
+}
+
+Solution sweep_grid(RiskMap const *m, int start_r, int start_c) {
+  Grid const *g = &m->shape;
+  Lanes ln16 = {sizeof(uint16_t), UINT16_MAX, relaxrow16, scanrow16};
+  Lanes ln32 = {sizeof(uint32_t), INF32, relaxrow32, scanrow32};
+#ifdef SSSP_X86
+  if (__builtin_cpu_supports("avx2")) {
+    ln16.relax = relaxrow16_avx2;
+    ln32.relax = relaxrow32_avx2;
+  }
+#endif
+  // The sweeps work in the cost layer of the solution, whose width is
+  // chosen by the same bound as the lanes need.
+  Solution sol = new_solution(g, start_r, start_c);
+  Lanes const *ln = sol.wide ? &ln32 : &ln16;
+  char *cost = sol.cost;
+
+  // The halo starts (and stays) at infinity, so relaxing from it does
+  // nothing.
+  for (size_t k = 0; k < gridsize(g); k++) {
+    ptrdiff_t i = gridlo(g) + (ptrdiff_t)k;
+    setcost(&sol, i, ln->inf);
+  }
+  unsigned char *buf = m->direct ? NULL : xmalloc(g->width);
+
+  // Every other cell is at infinity, so only the start's row starts out
+  // changed, once it has been scanned.
+  Pending p = {xcalloc(g->height, sizeof(Span)),
+               xcalloc(g->height, sizeof(Span))};
+  setcost(&sol, sol.start, 0);
+  char *row = cost + gridindex(g, start_r, 0) * (ptrdiff_t)ln->size;
+  Span s = {start_c, start_c + 1};
+  s = joinspan(s, ln->scan(row, riskrow(m, start_r, buf), s, g->width));
+  p.down[start_r] = p.up[start_r] = s;
+
+  long passes = 1;
+  while (sweep(m, ln, cost, buf, &p)) {
+    passes++;
+  }
+  dbgprintf("Sweeps converged after %ld passes of %d-bit lanes\n", passes,
+            sol.wide ? 32 : 16);
+  free(p.down);
+  free(p.up);
+  free(buf);
+
+  // Back to the conventions of a Solution: the halo at 0, and infinity (in
+  // wide lanes, below UNREACHED) UNREACHED.
+  for (size_t k = 0; k < gridsize(g); k++) {
+    ptrdiff_t i = gridlo(g) + (ptrdiff_t)k;
+    int r = gridrow(g, i), c = gridcol(g, i);
+    if (r < 0 || r >= g->height || c < 0 || c >= g->width) {
+      setcost(&sol, i, 0);
+    } else if (getcost(&sol, i) == ln->inf) {
+      setcost(&sol, i, UNREACHED);
+    }
+  }
+  canonical_preds(m, &sol, start_r, start_c);
+  return sol;
+}
+
+static int manhattan(int r0, int c0, int r1, int c1) {
+  return abs(r0 - r1) + abs(c0 - c1);
+}
+
+#define ASTARBUCKETS (2 * MAXRISK + 1)
+
+Solution astar_grid(RiskMap const *m, int start_r, int start_c, int goal_r,
+                    int goal_c) {
+  Grid const *g = &m->shape;
+  Solution s = new_solution(g, start_r, start_c);
+  Stencil n4 = gridn4(g);
+  ptrdiff_t goal = gridindex(g, goal_r, goal_c);
+  int minrisk = m->minrisk;
+  Bucket q[ASTARBUCKETS] = {0};
+  uint32_t f = minrisk * manhattan(start_r, start_c, goal_r, goal_c);
+  pushbucket(&q[f % ASTARBUCKETS], gridindex(g, start_r, start_c));
+  long pending = 1, settled = 0;
+
+  for (; pending; f++) {
+    Bucket *b = &q[f % ASTARBUCKETS];
+    for (size_t k = 0; k < b->len; k++) {
+      ptrdiff_t i = b->xs[k];
+      pending--;
+      int r = gridrow(g, i), c = gridcol(g, i);
+      uint32_t here = getcost(&s, i);
+      if (here + minrisk * manhattan(r, c, goal_r, goal_c) != f) {
+        continue; // stale
+      }
+      settled++;
+      if (i == goal) {
+        pending = 0;
+        break;
+      }
+      for (int n = 0; n < n4.n; n++) {
+        ptrdiff_t j = i + n4.d[n];
+        int rj = r + n4rows[n], cj = c + n4cols[n];
+        uint32_t d = here + riskat(m, j, rj, cj);
+        if (d < getcost(&s, j)) {
+          setcost(&s, j, d);
+          setpred(&s, j, oppositedir(n));
+          uint32_t fj = d + minrisk * manhattan(rj, cj, goal_r, goal_c);
+          pushbucket(&q[fj % ASTARBUCKETS], j);
+          pending++;
+        }
+      }
+    }
+    b->len = 0;
+  }
+  dbgprintf("A* settled %ld of %ld cells\n", settled, s.n);
+
+  for (int k = 0; k < ASTARBUCKETS; k++) {
+    free(q[k].xs);
+  }
+  return s;
+}
+
+// One side of a bidirectional search. The backward side's costs are to the
+// goal, excluding the risk of the cell itself, and its predecessors point
+// toward the goal.
+typedef struct {
+  Solution s;
+  Bucket q[MAXRISK + 1];
+  uint32_t level; // every cell of lower cost is settled
+  long pending;
+} Side;
+
+// Settle every cell of cost (self->level) and move on to the next level.
+// Whenever a cell reached from both sides gives a cheaper path than (*best),
+// record it and the cell in (*meet).
+static void expandside(RiskMap const *m, Side *self, Side const *other,
+                       bool backward, uint32_t *best, ptrdiff_t *meet) {
+  Grid const *g = &m->shape;
+  Stencil n4 = gridn4(g);
+  uint32_t d = self->level;
+  Bucket *b = &self->q[d % (MAXRISK + 1)];
+  for (size_t k = 0; k < b->len; k++) {
+    ptrdiff_t i = b->xs[k];
+    self->pending--;
+    if (getcost(&self->s, i) != d) {
+      continue;
+    }
+    int r = gridrow(g, i), c = gridcol(g, i);
+    // Backward, leaving a cell costs its own risk, whichever way one goes.
+    int out = backward ? riskat(m, i, r, c) : 0;
+    for (int n = 0; n < n4.n; n++) {
+      ptrdiff_t j = i + n4.d[n];
+      int w = backward ? out : riskat(m, j, r + n4rows[n], c + n4cols[n]);
+      if (d + w < getcost(&self->s, j)) {
+        setcost(&self->s, j, d + w);
+        setpred(&self->s, j, oppositedir(n));
+        pushbucket(&self->q[(d + w) % (MAXRISK + 1)], j);
+        self->pending++;
+        uint32_t there = getcost(&other->s, j);
+        if (there != UNREACHED && d + w + there < *best) {
+          *best = d + w + there;
+          *meet = j;
+        }
+      }
+    }
+  }
+  b->len = 0;
+  self->level++;
+}
+
+Solution bidir_grid(RiskMap const *m, int start_r, int start_c, int goal_r,
+                    int goal_c) {
+  Grid const *g = &m->shape;
+  Side fwd = {.s = new_solution(g, start_r, start_c), .pending = 1};
+  Side bwd = {.s = new_solution(g, goal_r, goal_c), .pending = 1};
+  pushbucket(&fwd.q[0], gridindex(g, start_r, start_c));
+  pushbucket(&bwd.q[0], gridindex(g, goal_r, goal_c));
+  // The start and the goal may be one cell.
+  uint32_t best = UNREACHED;
+  ptrdiff_t meet = gridindex(g, goal_r, goal_c);
+  if (meet == gridindex(g, start_r, start_c)) {
+    best = 0;
+  }
+
+  // A path through a cell neither side has settled costs at least the sum of
+  // the two levels.
+  while (fwd.pending && bwd.pending && fwd.level + bwd.level < best) {
+    if (fwd.pending <= bwd.pending) {
+      expandside(m, &fwd, &bwd, false, &best, &meet);
+    } else {
+      expandside(m, &bwd, &fwd, true, &best, &meet);
+    }
+  }
+  dbgprintf("Met at (%d, %d) with cost %u after levels %u and %u\n",
+            gridrow(g, meet), gridcol(g, meet), best, fwd.level, bwd.level);
+
+  // Splice the backward half onto the forward one: walk from the meeting
+  // cell to the goal, pointing each cell back at the one before.
+  Solution s = fwd.s;
+  Stencil n4 = gridn4(g);
+  ptrdiff_t goal = gridindex(g, goal_r, goal_c);
+  for (ptrdiff_t i = meet; i != goal;) {
+    int dir = getpred(&bwd.s, i);
+    ptrdiff_t j = i + n4.d[dir];
+    int r = gridrow(g, j), c = gridcol(g, j);
+    setcost(&s, j, getcost(&s, i) + riskat(m, j, r, c));
+    setpred(&s, j, oppositedir(dir));
+    i = j;
+  }
+  assert(best == UNREACHED || getcost(&s, goal) == best);
+
+  for (int k = 0; k <= MAXRISK; k++) {
+    free(fwd.q[k].xs);
+    free(bwd.q[k].xs);
+  }
+  delete_solution(bwd.s);
+  return s;
+}
+
+// Delta-stepping. Bucket k holds the cells of cost [k * delta, (k + 1) *
+// delta). No edge weighs more than MAXRISK, so the buckets that can be
+// nonempty fit in a ring of DELTASLOTS(delta).
+#define DELTASLOTS(delta) (MAXRISK / (delta) + 2)
+
+typedef enum { DELTA_START, DELTA_LIGHT, DELTA_HEAVY, DELTA_DONE } DeltaPhase;
+
+typedef struct DeltaShared DeltaShared;
+
+// A worker. Only it pushes to its buckets, so they need no locks; between
+// rounds, the buckets to work on are swapped into (taken), where every
+// worker reads them.
+typedef struct {
+  DeltaShared *sh;
+  int id;
+  pthread_t thread;
+  Bucket *slots;  // the ring of buckets
+  Bucket settled; // cells expanded in the current bucket
+  Bucket taken;
+} DeltaWorker;
+
+struct DeltaShared {
+  RiskMap const *m;
+  Solution *s;
+  uint32_t *expanded; // the cost of each cell when it was last expanded
+  int delta, nslots, nthreads;
+  DeltaWorker *workers;
+  pthread_barrier_t barrier;
+  // Set between rounds by one worker.
+  DeltaPhase phase;
+  long bucket;
+  size_t *offs; // where each worker's taken cells start in the round
+  size_t total;
+};
+
+// getcost(), atomically.
+static uint32_t loadcost(Solution const *s, ptrdiff_t i) {
+  if (s->wide) {
+    return __atomic_load_n((uint32_t *)s->cost + i, __ATOMIC_RELAXED);
+  }
+  uint16_t x = __atomic_load_n((uint16_t *)s->cost + i, __ATOMIC_RELAXED);
+  return x == UINT16_MAX ? UNREACHED : x;
+}
+
+// Lower the cost of cell (i) to (x) if that is lower. Return whether it was.
+static bool lowercost(Solution *s, ptrdiff_t i, uint32_t x) {
+  if (s->wide) {
+    uint32_t *p = (uint32_t *)s->cost + i;
+    uint32_t old = __atomic_load_n(p, __ATOMIC_RELAXED);
+    while (x < old) {
+      if (__atomic_compare_exchange_n(p, &old, x, true, __ATOMIC_RELAXED,
+                                      __ATOMIC_RELAXED)) {
+        return true;
+      }
+    }
+    return false;
+  }
+  uint16_t *p = (uint16_t *)s->cost + i;
+  uint16_t old = __atomic_load_n(p, __ATOMIC_RELAXED);
+  while (x < old) {
+    if (__atomic_compare_exchange_n(p, &old, x, true, __ATOMIC_RELAXED,
+                                    __ATOMIC_RELAXED)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Expand cell (i) over its light edges (weight up to delta) or its heavy
+// ones.
+static void deltaexpand(DeltaWorker *w, ptrdiff_t i, bool light) {
+  DeltaShared *sh = w->sh;
+  RiskMap const *m = sh->m;
+  Grid const *g = &m->shape;
+  uint32_t d = loadcost(sh->s, i);
+  if (light) {
+    if (d / sh->delta != sh->bucket) {
+      return; // stale
+    }
+    // This worker may have expanded it already. So may another, at the same
+    // time, but then both just do the same work.
+    uint32_t before = __atomic_load_n(&sh->expanded[i], __ATOMIC_RELAXED);
+    if (before == d) {
+      return;
+    }
+    __atomic_store_n(&sh->expanded[i], d, __ATOMIC_RELAXED);
+    if (sh->delta < MAXRISK &&
+        (before == UNREACHED || before / sh->delta != sh->bucket)) {
+      pushbucket(&w->settled, i);
+    }
+  }
+  int r = 0, c = 0;
+  if (!m->direct) {
+    r = gridrow(g, i);
+    c = gridcol(g, i);
+  }
+  Stencil n4 = gridn4(g);
+  for (int n = 0; n < n4.n; n++) {
+    ptrdiff_t j = i + n4.d[n];
+    int x = riskat(m, j, r + n4rows[n], c + n4cols[n]);
+    if ((x <= sh->delta) == light && lowercost(sh->s, j, d + x)) {
+      pushbucket(&w->slots[(d + x) / sh->delta % sh->nslots], j);
+    }
+  }
+}
+
+// Swap every worker's bucket (which) into its taken one, and lay them end
+// to end.
+static void deltatake(DeltaShared *sh, bool settled) {
+  sh->total = 0;
+  for (int t = 0; t < sh->nthreads; t++) {
+    DeltaWorker *w = &sh->workers[t];
+    Bucket *b = settled ? &w->settled : &w->slots[sh->bucket % sh->nslots];
+    Bucket spare = w->taken;
+    w->taken = *b;
+    *b = spare;
+    b->len = 0;
+    sh->offs[t] = sh->total;
+    sh->total += w->taken.len;
+  }
+  sh->offs[sh->nthreads] = sh->total;
+}
+
+// Decide what the next round does (on one worker, while the others wait).
+static void deltanext(DeltaShared *sh) {
+  if (sh->phase == DELTA_HEAVY) {
+    // Move on to the next nonempty bucket, if any.
+    long next = -1;
+    for (int k = 1; next < 0 && k <= sh->nslots; k++) {
+      for (int t = 0; t < sh->nthreads; t++) {
+        if (sh->workers[t].slots[(sh->bucket + k) % sh->nslots].len) {
+          next = sh->bucket + k;
+          break;
+        }
+      }
+    }
+    if (next < 0) {
+      sh->phase = DELTA_DONE;
+      return;
+    }
+    sh->bucket = next;
+  }
+  // Relax light edges until the bucket stays empty, then heavy edges once.
+  deltatake(sh, false);
+  if (sh->total) {
+    sh->phase = DELTA_LIGHT;
+  } else {
+    deltatake(sh, true);
+    sh->phase = DELTA_HEAVY;
+  }
+}
+
+static void *deltaloop(void *arg) {
+  DeltaWorker *w = arg;
+  DeltaShared *sh = w->sh;
+  for (;;) {
+    if (pthread_barrier_wait(&sh->barrier) == PTHREAD_BARRIER_SERIAL_THREAD) {
+      deltanext(sh);
+    }
+    pthread_barrier_wait(&sh->barrier);
+    if (sh->phase == DELTA_DONE) {
+      return NULL;
+    }
+    // An even share of the cells taken by all workers.
+    size_t lo = sh->total * w->id / sh->nthreads;
+    size_t hi = sh->total * (w->id + 1) / sh->nthreads;
+    int t = 0;
+    for (size_t k = lo; k < hi; k++) {
+      while (k >= sh->offs[t + 1]) {
+        t++;
+      }
+      ptrdiff_t i = sh->workers[t].taken.xs[k - sh->offs[t]];
+      deltaexpand(w, i, sh->phase == DELTA_LIGHT);
+    }
+  }
+}
+
+Solution delta_grid(RiskMap const *m, int start_r, int start_c, int nthreads,
+                    int delta) {
+  Grid const *g = &m->shape;
+  if (nthreads <= 0) {
+    nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+  }
+  assert(delta >= 1);
+  Solution s = new_solution(g, start_r, start_c);
+  DeltaShared sh = {
+      .m = m,
+      .s = &s,
+      .expanded = xmkgridlayer(g, sizeof(uint32_t)),
+      .delta = delta,
+      .nslots = DELTASLOTS(delta),
+      .nthreads = nthreads,
+      .workers = xcalloc(nthreads, sizeof(DeltaWorker)),
+      .phase = DELTA_START,
+      .offs = xcalloc(nthreads + 1, sizeof(size_t)),
+  };
+  for (size_t k = 0; k < gridsize(g); k++) {
+    sh.expanded[gridlo(g) + (ptrdiff_t)k] = UNREACHED;
+  }
+  for (int t = 0; t < nthreads; t++) {
+    sh.workers[t] = (DeltaWorker){
+        .sh = &sh, .id = t, .slots = xcalloc(sh.nslots, sizeof(Bucket))};
+  }
+  pushbucket(&sh.workers[0].slots[0], gridindex(g, start_r, start_c));
+  pthread_barrier_init(&sh.barrier, NULL, nthreads);
+
+  // This thread is worker 0.
+  for (int t = 1; t < nthreads; t++) {
+    int err = pthread_create(&sh.workers[t].thread, NULL, deltaloop,
+                             &sh.workers[t]);
+    if (err) {
+      fprintf(stderr, "pthread_create: %s\n", strerror(err));
+      abort();
+    }
+  }
+  deltaloop(&sh.workers[0]);
+  for (int t = 1; t < nthreads; t++) {
+    pthread_join(sh.workers[t].thread, NULL);
+  }
+  dbgprintf("Delta-stepping reached bucket %ld on %d threads\n", sh.bucket,
+            nthreads);
+
+  pthread_barrier_destroy(&sh.barrier);
+  for (int t = 0; t < nthreads; t++) {
+    for (int k = 0; k < sh.nslots; k++) {
+      free(sh.workers[t].slots[k].xs);
+    }
+    free(sh.workers[t].slots);
+    free(sh.workers[t].settled.xs);
+    free(sh.workers[t].taken.xs);
+  }
+  free(sh.workers);
+  free(sh.offs);
+  freegridlayer(g, sh.expanded, sizeof(uint32_t));
+  canonical_preds(m, &s, start_r, start_c);
+  return s;
+}
+
+RiskChanges xsetrisks(RiskMap *m, RiskUpdate const *u, size_t n) {
+  Grid const *base = m->base;
+  int lo = m->direct ? 0 : 1;
+  size_t cap = n * m->tiles * m->tiles;
+  RiskChanges ch = {.xs = xcalloc(cap ? cap : 1, sizeof(RiskChange))};
+  for (size_t k = 0; k < n; k++) {
+    if (!inshape(base, u[k].row, u[k].column) || u[k].risk < lo ||
+        u[k].risk > MAXRISK) {
+      fprintf(stderr, "xsetrisks: risk %d at (%d, %d) is not in %d..%d\n",
+              u[k].risk, u[k].row, u[k].column, lo, MAXRISK);
+      abort();
+    }
+    signed char *cell = gridat(base, u[k].row, u[k].column);
+    for (int tr = 0; tr < m->tiles; tr++) {
+      for (int tc = 0; tc < m->tiles; tc++) {
+        int r = tr * base->height + u[k].row;
+        int c = tc * base->width + u[k].column;
+        ch.xs[ch.len++] = (RiskChange){
+            .i = gridindex(&m->shape, r, c),
+            .row = r,
+            .column = c,
+            .old = m->direct ? *cell : m->wrap[*cell + tr + tc],
+        };
+        int risk = m->direct ? u[k].risk : m->wrap[u[k].risk + tr + tc];
+        m->minrisk = risk < m->minrisk ? risk : m->minrisk;
+      }
+    }
+    *cell = u[k].risk;
+  }
+
+  // Keep the cells whose risk differs in the end. Of a cell updated more than
+  // once, the first change has its risk from before.
+  size_t len = 0;
+  for (size_t k = 0; k < ch.len; k++) {
+    RiskChange x = ch.xs[k];
+    if (riskat(m, x.i, x.row, x.column) != x.old) {
+      ch.xs[len++] = x;
+    }
+  }
+  ch.len = len;
+  return ch;
+}
+
+void freeriskchanges(RiskChanges ch) { free(ch.xs); }
+
+// A cell to be costed again, and the cost it starts from.
+typedef struct {
+  uint32_t cost;
+  ptrdiff_t i;
+} Seed;
+
+static int cmpseeds(void const *a, void const *b) {
+  uint32_t x = ((Seed const *)a)->cost, y = ((Seed const *)b)->cost;
+  return (x > y) - (x < y);
+}
+
+// Cost cell (i) from its cheapest neighbor, if that lowers it. Return whether
+// it did.
+static bool relaxcell(RiskMap const *m, Solution *s, ptrdiff_t i) {
+  Grid const *g = &m->shape;
+  Stencil n4 = gridn4(g);
+  int r = gridrow(g, i), c = gridcol(g, i);
+  int risk = riskat(m, i, r, c);
+  uint32_t best = getcost(s, i);
+  int dir = -1;
+  for (int k = 0; k < n4.n; k++) {
+    uint32_t from = getcost(s, i + n4.d[k]);
+    if (inshape(g, r + n4rows[k], c + n4cols[k]) && from != UNREACHED &&
+        from + risk < best) {
+      best = from + risk;
+      dir = k;
+    }
+  }
+  if (dir < 0) {
+    return false;
+  }
+  setcost(s, i, best);
+  setpred(s, i, dir);
+  return true;
+}
+
+long repair_grid(RiskMap const *m, Solution *s, RiskChanges const *ch) {
+  Grid const *g = &m->shape;
+  Stencil n4 = gridn4(g);
+  // Every cell whose cost was rewritten, in the order it was, with repeats.
+  Bucket touched = {0};
+
+  // A cell that got riskier takes every cell whose path runs through it
+  // along: reset them all, walking the predecessors backwards.
+  Bucket stack = {0};
+  for (size_t k = 0; k < ch->len; k++) {
+    RiskChange x = ch->xs[k];
+    if (x.i == s->start || riskat(m, x.i, x.row, x.column) < x.old) {
+      continue;
+    }
+    pushbucket(&stack, x.i);
+    while (stack.len) {
+      ptrdiff_t i = stack.xs[--stack.len];
+      if (getcost(s, i) == UNREACHED) {
+        continue;
+      }
+      setcost(s, i, UNREACHED);
+      pushbucket(&touched, i);
+      int r = gridrow(g, i), c = gridcol(g, i);
+      for (int n = 0; n < n4.n; n++) {
+        ptrdiff_t j = i + n4.d[n];
+        if (inshape(g, r + n4rows[n], c + n4cols[n]) && j != s->start &&
+            getcost(s, j) != UNREACHED && j + n4.d[getpred(s, j)] == i) {
+          pushbucket(&stack, j);
+        }
+      }
+    }
+  }
+  free(stack.xs);
+
+  // Cost the reset cells from whatever neighbors they have left, and the
+  // cells that got less risky from theirs.
+  size_t nseeds = 0, cap = touched.len + ch->len;
+  Seed *seeds = xcalloc(cap ? cap : 1, sizeof(Seed));
+  for (size_t k = 0; k < touched.len; k++) {
+    ptrdiff_t i = touched.xs[k];
+    if (relaxcell(m, s, i)) {
+      seeds[nseeds++] = (Seed){getcost(s, i), i};
+    }
+  }
+  for (size_t k = 0; k < ch->len; k++) {
+    ptrdiff_t i = ch->xs[k].i;
+    if (i != s->start && relaxcell(m, s, i)) {
+      seeds[nseeds++] = (Seed){getcost(s, i), i};
+      pushbucket(&touched, i);
+    }
+  }
+  qsort(seeds, nseeds, sizeof(Seed), cmpseeds);
+
+  // Dial's algorithm from the seeds, each joining the queue once the queue
+  // reaches its cost. Costs may only drop from here, and a cell that keeps
+  // its cost stops the spreading.
+  Bucket q[MAXRISK + 1] = {0};
+  long pending = 0;
+  size_t next = 0;
+  for (uint32_t d = nseeds ? seeds[0].cost : 0; pending || next < nseeds;
+       d++) {
+    if (!pending && seeds[next].cost > d) {
+      d = seeds[next].cost;
+    }
+    for (; next < nseeds && seeds[next].cost == d; next++) {
+      pushbucket(&q[d % (MAXRISK + 1)], seeds[next].i);
+      pending++;
+    }
+    Bucket *b = &q[d % (MAXRISK + 1)];
+    for (size_t k = 0; k < b->len; k++) {
+      ptrdiff_t i = b->xs[k];
+      pending--;
+      if (getcost(s, i) != d) {
+        continue;
+      }
+      int r = 0, c = 0;
+      if (!m->direct) {
+        r = gridrow(g, i);
+        c = gridcol(g, i);
+      }
+      for (int n = 0; n < n4.n; n++) {
+        ptrdiff_t j = i + n4.d[n];
+        int w = riskat(m, j, r + n4rows[n], c + n4cols[n]);
+        if (d + w < getcost(s, j)) {
+          setcost(s, j, d + w);
+          setpred(s, j, oppositedir(n));
+          pushbucket(&q[(d + w) % (MAXRISK + 1)], j);
+          pushbucket(&touched, j);
+          pending++;
+        }
+      }
+    }
+    b->len = 0;
+  }
+  for (int k = 0; k <= MAXRISK; k++) {
+    free(q[k].xs);
+  }
+  free(seeds);
+
+  // A cell's canonical predecessor depends on its neighbors' costs, so point
+  // the rewritten cells and their neighbors again. Cells of risk 0 keep the
+  // predecessor they were costed from, which cannot form a cycle: it got its
+  // cost first.
+  for (size_t k = 0; k < touched.len; k++) {
+    ptrdiff_t i = touched.xs[k];
+    int r = gridrow(g, i), c = gridcol(g, i);
+    for (int n = -1; n < n4.n; n++) {
+      ptrdiff_t j = n < 0 ? i : i + n4.d[n];
+      int rj = n < 0 ? r : r + n4rows[n], cj = n < 0 ? c : c + n4cols[n];
+      int risk;
+      if (inshape(g, rj, cj) && j != s->start &&
+          (risk = riskat(m, j, rj, cj))) {
+        pointcell(m, s, j, rj, cj, risk);
+      }
+    }
+  }
+  long rewritten = touched.len;
+  free(touched.xs);
+  dbgprintf("Repaired %zu changes with %ld cost updates\n", ch->len,
+            rewritten);
+  return rewritten;
+}
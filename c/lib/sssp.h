@@ -0,0 +1,230 @@
+#ifndef SSSP_H
+#define SSSP_H
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "grid.h"
+
+// Single-source shortest paths on a risk map (day 15): entering a cell costs
+// its risk.
+//
+// A Solution holds layers laid out like the map's shape (see xmkgridlayer()),
+// whose halo cells cost 0 so that relaxing into the halo never succeeds.
+
+typedef struct _cursor_t {
+  int row, column;
+} Cursor;
+
+#define cursor(r, c)                                                           \
+  (Cursor) { .row = (r), .column = (c) }
+
+#define PRIcursor(co) (co).row, (co).column
+
+// Parse "row,col" into (*co). Return false unless (s) is just that.
+bool parsecell(char const *s, Cursor *co);
+
+// Whether (co) is a cell of (shape), not of its halo.
+static inline bool inmap(Grid const *shape, Cursor co) {
+  return co.row >= 0 && co.row < shape->height && co.column >= 0 &&
+         co.column < shape->width;
+}
+
+// The halo of a grid of risks, as xloaddigitgrid() is to load it.
+#define WALL 0
+
+// The largest risk in a map.
+#define MAXRISK 9
+
+// Costs take 16 bits when no cell of the map can cost more than that (see
+// new_solution()), 32 otherwise. A predecessor takes 2 bits: the direction,
+// in the order of gridn4(), of the neighbor the cell is entered from. The
+// start has none, and neither has a cell no path reaches.
+typedef struct _solution_t {
+  void *cost;          // uint16_t or uint32_t, by (wide)
+  unsigned char *pred; // four to a byte, by index from gridlo()
+  bool wide;
+  Grid shape; // without cells
+  ptrdiff_t start;
+  long n;
+} Solution;
+
+// The cost of a cell no path reaches.
+#define UNREACHED UINT32_MAX
+
+static inline uint32_t getcost(Solution const *s, ptrdiff_t i) {
+  if (s->wide) {
+    return ((uint32_t const *)s->cost)[i];
+  }
+  uint16_t x = ((uint16_t const *)s->cost)[i];
+  return x == UINT16_MAX ? UNREACHED : x;
+}
+
+static inline void setcost(Solution *s, ptrdiff_t i, uint32_t x) {
+  if (s->wide) {
+    ((uint32_t *)s->cost)[i] = x;
+  } else {
+    ((uint16_t *)s->cost)[i] = x;
+  }
+}
+
+static inline int getpred(Solution const *s, ptrdiff_t i) {
+  size_t k = i - gridlo(&s->shape);
+  return s->pred[k / 4] >> (k % 4 * 2) & 3;
+}
+
+static inline void setpred(Solution *s, ptrdiff_t i, int dir) {
+  size_t k = i - gridlo(&s->shape);
+  unsigned char *p = &s->pred[k / 4];
+  *p = (*p & ~(3 << (k % 4 * 2))) | dir << (k % 4 * 2);
+}
+
+// The direction back along a step in direction (dir).
+static inline int oppositedir(int dir) { return dir ^ 1; }
+
+// A map of (tiles) by (tiles) copies of a base grid of risks 1 to MAXRISK.
+// Each copy one tile further right or down adds 1 to every risk, wrapping
+// from MAXRISK back to 1. Only the base is stored: risks elsewhere are looked
+// up through per-row and per-column tables and a wrap-around table.
+typedef struct {
+  Grid const *base;
+  int tiles;
+  Grid shape;  // the layout of the whole map, without cells
+  bool direct; // a single tile: indices into shape are indices into base
+  // Per row and per column, halo included (so index -1 is valid): the offset
+  // of the base row or column, and the number of tiles before it.
+  ptrdiff_t *rowoff;
+  int *coloff, *rowadd, *coladd;
+  signed char *wrap; // wrap[v + k]: risk v raised by k
+  int minrisk;       // the smallest risk of any cell
+} RiskMap;
+
+// Build the map over (base), which needs a halo of at least 1. Abort on
+// failure.
+RiskMap xmkriskmap(Grid const *base, int tiles);
+
+void freeriskmap(RiskMap m);
+
+// The risk of the cell at index (i), row (r) and column (c) of the map. The
+// row and column are only looked at when the map is tiled.
+static inline int riskat(RiskMap const *m, ptrdiff_t i, int r, int c) {
+  if (m->direct) {
+    return m->base->cells[i];
+  }
+  return m->wrap[m->base->cells[m->rowoff[r] + m->coloff[c]] + m->rowadd[r] +
+                 m->coladd[c]];
+}
+
+// Row and column steps in the order of gridn4(): up, down, left, right.
+extern int const n4rows[4], n4cols[4];
+
+#define for_rc(g, r, c)                                                        \
+  for (int r = 0; r < (g).height; r++)                                         \
+    for (int c = 0; c < (g).width; c++)
+
+// A solution over (shape) with the halo at 0, every cell UNREACHED, and the
+// start at 0. A cell is at most (width + height - 2) steps from the start, so
+// costs are narrow if MAXRISK times that fits. Abort on failure.
+Solution new_solution(Grid const *shape, int start_r, int start_c);
+
+void delete_solution(Solution s);
+
+// A walk along a path, from its last cell back to the start.
+typedef struct {
+  Solution const *s;
+  ptrdiff_t i;
+  Cursor at;
+} PathWalk;
+
+// Start a walk at row (r), column (c). Return false if no path reaches it.
+bool walkpath(PathWalk *w, Solution const *s, int r, int c);
+
+// Step to the predecessor. Return false, without moving, at the start.
+bool stepback(PathWalk *w);
+
+// The cells of the path to row (r), column (c), from the start, in (*path).
+// Return their number, or 0 if no path reaches it. Abort on failure.
+long xtracepath(Solution const *s, int r, int c, Cursor **path);
+
+// Point every reached cell but the start at its first neighbor, in the order
+// up, down, left, right, that a shortest path can come from. Shortest paths
+// tie often, so this makes the predecessors of every solver agree.
+void canonical_preds(RiskMap const *m, Solution *s, int start_r, int start_c);
+
+// Relax every edge until nothing changes. O(V^2) in the worst case.
+Solution bellman_ford_grid(RiskMap const *m, int start_r, int start_c);
+
+// Dijkstra with a circular bucket queue (Dial's algorithm): risks are small
+// integers, so MAXRISK + 1 buckets indexed by cost modulo MAXRISK + 1 hold
+// the whole frontier, and no comparisons are needed. O(V + MAXRISK).
+Solution dial_grid(RiskMap const *m, int start_r, int start_c);
+
+// Relax whole rows at once, from the row above on the way down and from the
+// row below on the way back up, scanning each row both ways in between, until
+// a pass changes nothing. Only the columns that changed in the neighboring
+// row are relaxed. Costs live in saturating 16-bit lanes when the map is
+// small enough for them, 32-bit ones otherwise; row relaxation uses AVX2
+// where the CPU has it. Few passes suffice unless the paths wind a lot.
+Solution sweep_grid(RiskMap const *m, int start_r, int start_c);
+
+// Delta-stepping on (nthreads) threads (0: one per online CPU). Cells are
+// kept in buckets of costs (delta) wide. The threads expand the cells of the
+// lowest nonempty bucket together, over edges of weight up to (delta), until
+// the bucket stays empty, then once over the heavier edges. Each thread
+// pushes to buckets of its own, and costs are lowered with compare and swap.
+Solution delta_grid(RiskMap const *m, int start_r, int start_c, int nthreads,
+                    int delta);
+
+// The point-to-point solvers below stop once the cost of the goal is known.
+// Only the cells of the path they found, from the start to the goal, are
+// certain to have exact costs and predecessors.
+
+// A*: Dial's algorithm keyed by cost plus a lower bound on the cost left, the
+// Manhattan distance to the goal times the smallest risk in the map. The
+// bound never drops by more than a step costs, so a cell is settled the first
+// time it comes out of the queue, and the keys stay within 2 * MAXRISK of
+// the smallest.
+Solution astar_grid(RiskMap const *m, int start_r, int start_c, int goal_r,
+                    int goal_c);
+
+// Bidirectional Dial: search forward from the start and backward from the
+// goal, one cost level at a time on the side with the smaller frontier,
+// until the levels settled on the two sides add up to at least the cheapest
+// path seen through a cell reached from both.
+Solution bidir_grid(RiskMap const *m, int start_r, int start_c, int goal_r,
+                    int goal_c);
+
+// New risks for cells of a map's base grid, by base row and column.
+typedef struct {
+  int row, column, risk;
+} RiskUpdate;
+
+// A cell of the map whose risk changed from (old).
+typedef struct {
+  ptrdiff_t i;
+  int row, column;
+  int old;
+} RiskChange;
+
+typedef struct {
+  RiskChange *xs;
+  size_t len;
+} RiskChanges;
+
+// Write the (n) updates into the base grid of (m), in order, and lower the
+// map's smallest risk if need be. A base cell of a tiled map changes in every
+// tile. Return the cells of the map whose risk changed. Abort if a cell is
+// outside the base or a risk out of range.
+RiskChanges xsetrisks(RiskMap *m, RiskUpdate const *u, size_t n);
+
+void freeriskchanges(RiskChanges ch);
+
+// Bring (s), a full solution of (m) before the changes (ch), up to date.
+// Cells whose path went through a cell that got riskier are reset, with the
+// subtree below them, and costed again from their neighbors; cells that got
+// less risky are relaxed from their neighbors. Either way, a bucket queue
+// spreads the new costs only as far as they change anything. Then the
+// predecessors of the cells around those are made canonical again; on a map
+// with cells of risk 0, those cells may point elsewhere than after a full
+// solve, along an equally cheap path. Return the number of costs rewritten.
+long repair_grid(RiskMap const *m, Solution *s, RiskChanges const *ch);
+#endif
@@ -0,0 +1,206 @@
+#include "xalloc.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "stream.h"
+
+typedef struct {
+  char *buf;
+  size_t len;
+  bool full; // filled by the reader and not yet released by the consumer
+  bool last; // nothing follows this block
+  int error; // errno of the read that failed in this block, or 0
+} Slot;
+
+struct stream_t {
+  int fd;
+  size_t cap;
+  Slot slots[2];
+  pthread_t reader;
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  int next;   // slot the consumer takes next
+  bool held;  // the consumer holds the other slot
+  bool done;  // the consumer has taken the last block
+  bool stop;  // the consumer is closing the stream
+  bool ended; // the reader has returned, or is about to
+};
+
+// Wait for slot (j) to be free. Return false if the stream is closing.
+static bool waitempty(Stream *s, int j) {
+  pthread_mutex_lock(&s->lock);
+  while (s->slots[j].full && !s->stop) {
+    pthread_cond_wait(&s->changed, &s->lock);
+  }
+  bool stop = s->stop;
+  pthread_mutex_unlock(&s->lock);
+  return !stop;
+}
+
+static bool stopping(Stream *s) {
+  pthread_mutex_lock(&s->lock);
+  bool stop = s->stop;
+  pthread_mutex_unlock(&s->lock);
+  return stop;
+}
+
+static void freestream(Stream *s) {
+  if (s->fd != STDIN_FILENO) {
+    close(s->fd);
+  }
+  pthread_mutex_destroy(&s->lock);
+  pthread_cond_destroy(&s->changed);
+  for (int j = 0; j < 2; j++) {
+    free(s->slots[j].buf);
+  }
+  free(s);
+}
+
+static void readblocks(Stream *s) {
+  // The partial line at the end of the previous block.
+  char const *carry = NULL;
+  size_t ncarry = 0;
+  for (int j = 0;; j ^= 1) {
+    if (!waitempty(s, j)) {
+      return;
+    }
+    Slot *sl = &s->slots[j];
+    // The carry lives past the end of the other block, which the consumer
+    // never looks at, so it can be copied while that block is in use.
+    if (ncarry) {
+      memcpy(sl->buf, carry, ncarry);
+    }
+    size_t len = ncarry;
+    bool eof = false;
+    int error = 0;
+    bool newline = false;
+    while (len < s->cap) {
+      size_t want = s->cap - len;
+      ssize_t n = read(s->fd, sl->buf + len, want);
+      if (stopping(s)) {
+        return;
+      }
+      if (n > 0) {
+        newline = newline || memchr(sl->buf + len, '\n', n);
+        len += n;
+        // A short read drained a pipe or terminal: hand out the whole lines
+        // so far rather than wait on the upstream for more.
+        if ((size_t)n < want && newline) {
+          break;
+        }
+      } else if (n == 0) {
+        eof = true;
+        break;
+      } else if (errno != EINTR) {
+        error = errno;
+        eof = true;
+        break;
+      }
+    }
+
+    // Cut after the last newline; a block without one goes out whole.
+    size_t cut = len;
+    if (!eof) {
+      while (cut > 0 && sl->buf[cut - 1] != '\n') {
+        cut--;
+      }
+      cut = cut ? cut : len;
+    }
+    carry = sl->buf + cut;
+    ncarry = len - cut;
+
+    pthread_mutex_lock(&s->lock);
+    sl->len = cut;
+    sl->last = eof;
+    sl->full = true;
+    sl->error = error;
+    pthread_cond_broadcast(&s->changed);
+    pthread_mutex_unlock(&s->lock);
+    if (eof) {
+      return;
+    }
+  }
+}
+
+// Read until the end of the input or until the stream is closed. If it was
+// closed while a read() was waiting on its upstream, the reader was left to
+// free the stream.
+static void *readloop(void *arg) {
+  Stream *s = arg;
+  readblocks(s);
+  pthread_mutex_lock(&s->lock);
+  s->ended = true;
+  bool orphaned = s->stop;
+  pthread_mutex_unlock(&s->lock);
+  if (orphaned) {
+    freestream(s);
+  }
+  return NULL;
+}
+
+Stream *xopenstream(int fd, size_t blocksize) {
+  Stream *s = xcalloc(1, sizeof(Stream));
+  s->fd = fd;
+  s->cap = blocksize;
+  for (int j = 0; j < 2; j++) {
+    s->slots[j].buf = xmalloc(blocksize);
+  }
+  pthread_mutex_init(&s->lock, NULL);
+  pthread_cond_init(&s->changed, NULL);
+  int err = pthread_create(&s->reader, NULL, readloop, s);
+  if (err) {
+    fprintf(stderr, "xopenstream: pthread_create: %s\n", strerror(err));
+    abort();
+  }
+  return s;
+}
+
+bool nextblock(Stream *s, Input *block) {
+  pthread_mutex_lock(&s->lock);
+  if (s->held) {
+    // The caller is done with the block handed out last time.
+    s->slots[s->next ^ 1].full = false;
+    s->held = false;
+    pthread_cond_broadcast(&s->changed);
+  }
+  if (s->done) {
+    pthread_mutex_unlock(&s->lock);
+    return false;
+  }
+  Slot *sl = &s->slots[s->next];
+  while (!sl->full) {
+    pthread_cond_wait(&s->changed, &s->lock);
+  }
+  if (sl->error) {
+    fprintf(stderr, "nextblock: read: %s\n", strerror(sl->error));
+    abort();
+  }
+  *block = (Input){.buf = sl->buf, .len = sl->len, .pos = 0, .mapped = false};
+  s->done = sl->last;
+  s->held = true;
+  s->next ^= 1;
+  pthread_mutex_unlock(&s->lock);
+  return sl->len > 0 || !sl->last;
+}
+
+void closestream(Stream *s) {
+  pthread_mutex_lock(&s->lock);
+  s->stop = true;
+  pthread_cond_broadcast(&s->changed);
+  bool ended = s->ended;
+  pthread_t reader = s->reader;
+  pthread_mutex_unlock(&s->lock);
+  if (!ended) {
+    // The reader may be blocked in read() for as long as the upstream likes;
+    // rather than wait, leave it to free the stream, which it may do at any
+    // moment from now on, when it wakes.
+    pthread_detach(reader);
+    return;
+  }
+  pthread_join(s->reader, NULL);
+  freestream(s);
+}
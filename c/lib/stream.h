@@ -0,0 +1,35 @@
+#ifndef STREAM_H
+#define STREAM_H
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "input.h"
+
+// Default block size for xopenstream().
+#define STREAMBLOCK (1 << 20)
+
+// A double-buffered reader for unbounded inputs such as pipes. A reader
+// thread fills one buffer while the caller works on the other, so memory use
+// is two blocks no matter how long the input is.
+typedef struct stream_t Stream;
+
+// Start reading (fd) in blocks of (blocksize) bytes on a reader thread. The
+// stream owns (fd), and closes it unless it is standard input. Abort on
+// failure.
+Stream *xopenstream(int fd, size_t blocksize);
+
+// Hand out the next block. Blocks end just after a '\n' (or at the end of the
+// input), so lines and numbers are never split between blocks, unless a
+// single line is longer than a whole block. A block may be short: once the
+// input has no more to give for now, the lines read so far go out.
+//
+// The block is an Input that borrows the stream's buffer: iterate it with
+// nextline(), nexttoken() and so on, but never closeinput() it. It stays
+// valid until the next call. Return false at end of input.
+bool nextblock(Stream *s, Input *block);
+
+// Stop the reader thread, free the buffers and close the input. Return at
+// once, even if the reader is waiting on a read(): it then does all that
+// itself when the read returns.
+void closestream(Stream *s);
+#endif
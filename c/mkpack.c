@@ -0,0 +1,131 @@
+// Convert a puzzle input on stdin into a preparsed pack (see lib/pack.h) on
+// stdout, so that solvers given the pack skip the text parse.
+//
+//   mkpack grid < 11.in > 11.pack   digit grid: one U8 section of values
+//   mkpack dots < 13.in > 13.pack   day 13: I32 (column, row) pairs, then
+//                                   I32 (axis, line) folds, axis 'x' or 'y'
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lib/input.h"
+#include "lib/pack.h"
+#include "lib/parseint.h"
+#include "lib/xalloc.h"
+
+// Coordinates parsed per call to parselongs(); even, so pairs stay whole.
+#define BATCH 4096
+
+typedef struct {
+  int32_t *xs;
+  size_t len, cap;
+} I32Vec;
+
+static void insi32vec(I32Vec *v, int32_t x) {
+  if (v->len == v->cap) {
+    v->cap = v->cap ? v->cap * 2 : 64;
+    v->xs = xrealloc(v->xs, v->cap * sizeof(int32_t));
+  }
+  v->xs[v->len++] = x;
+}
+
+static int packgrid(Input *in) {
+  StrView line;
+  uint8_t *cells = NULL;
+  size_t rows = 0, cols = 0;
+  while (nextline(in, &line) && line.len) {
+    if (!cols) {
+      cols = line.len;
+    } else if (line.len != cols) {
+      fprintf(stderr, "mkpack: row %zu has %zu columns, not %zu\n", rows + 1,
+              line.len, cols);
+      free(cells);
+      return 1;
+    }
+    cells = xrealloc(cells, (rows + 1) * cols);
+    for (size_t c = 0; c < cols; c++) {
+      unsigned d = (unsigned char)line.p[c] - '0';
+      if (d > 9) {
+        fprintf(stderr, "mkpack: not a digit at row %zu, column %zu\n",
+                rows + 1, c + 1);
+        free(cells);
+        return 1;
+      }
+      cells[rows * cols + c] = d;
+    }
+    rows++;
+  }
+  PackSection s = {.type = PACK_U8, .rows = rows, .cols = cols, .data = cells};
+  xwritepack(stdout, &s, 1);
+  free(cells);
+  return 0;
+}
+
+static int packdots(Input *in) {
+  I32Vec dots = {0}, folds = {0};
+  char const *p = in->buf, *end = in->buf + in->len;
+  long xy[BATCH];
+  size_t n;
+  while ((n = parselongs(&p, end, xy, BATCH))) {
+    // Only the last batch can be short, and must not end in half a pair.
+    if (n % 2) {
+      fprintf(stderr, "mkpack: a dot has column %ld but no row\n", xy[n - 1]);
+      free(dots.xs);
+      free(folds.xs);
+      return 1;
+    }
+    for (size_t i = 0; i < n; i += 2) {
+      insi32vec(&dots, xy[i]);
+      insi32vec(&dots, xy[i + 1]);
+    }
+  }
+  in->pos = p - in->buf;
+
+  static char const prefix[] = "fold along ";
+  StrView line;
+  while (nextline(in, &line)) {
+    if (!line.len) {
+      continue;
+    }
+    if (!svprefix(line, prefix) || line.len < sizeof(prefix) + 2 ||
+        line.p[sizeof(prefix)] != '=') {
+      fprintf(stderr, "mkpack: bad fold \"%.*s\"\n", PRIsv(line));
+      free(dots.xs);
+      free(folds.xs);
+      return 1;
+    }
+    line = svskip(line, sizeof(prefix) - 1);
+    insi32vec(&folds, line.p[0]);
+    insi32vec(&folds, svtol(svskip(line, 2), 10, NULL));
+  }
+
+  PackSection s[2] = {
+      {.type = PACK_I32, .rows = dots.len / 2, .cols = 2, .data = dots.xs},
+      {.type = PACK_I32, .rows = folds.len / 2, .cols = 2, .data = folds.xs},
+  };
+  xwritepack(stdout, s, 2);
+  free(dots.xs);
+  free(folds.xs);
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 2) {
+    fprintf(stderr, "Usage: %s grid|dots < input > pack\n", argv[0]);
+    return 1;
+  }
+  Input *in = xopeninput(NULL);
+  int status;
+  if (strcmp(argv[1], "grid") == 0) {
+    status = packgrid(in);
+  } else if (strcmp(argv[1], "dots") == 0) {
+    status = packdots(in);
+  } else {
+    fprintf(stderr, "%s: unknown kind \"%s\"\n", argv[0], argv[1]);
+    status = 1;
+  }
+  closeinput(in);
+  return status;
+}
@@ -0,0 +1,224 @@
+// octobench.c -- compare ways of stepping the octopuses of day 11.
+//
+// Usage: ./octobench.[dbg|rel] [size] [steps] [repeats] [threads]
+//
+// A random (size) by (size) board (1000 by default) takes (steps) steps (100)
+// along each path; the tiled one runs on (threads) threads (0, the default:
+// one per CPU). The flash count and a hash of the final board must agree
+// across paths.
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lib/grid.h"
+#include "lib/octopus.h"
+#include "lib/octoslice.h"
+#include "lib/xalloc.h"
+
+#define WALL SCHAR_MIN
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void incall(Grid *g) {
+  for (int r = 0; r < g->height; r++) {
+    for (int c = 0; c < g->width; c++) {
+      (*gridat(g, r, c))++;
+    }
+  }
+}
+
+static void truncall(Grid *g) {
+  for (int r = 0; r < g->height; r++) {
+    for (int c = 0; c < g->width; c++) {
+      signed char *x = gridat(g, r, c);
+      *x = (*x > 9 || *x < 0) ? 0 : *x;
+    }
+  }
+}
+
+// What day 11 did originally: rescan the whole board for octopuses over 9
+// until none are left.
+static long by_rescan(Grid *g, int steps) {
+  Stencil n8 = gridn8(g);
+  long flash = 0;
+  for (int s = 0; s < steps; s++) {
+    incall(g);
+    for (bool more = true; more;) {
+      more = false;
+      for (int r = 0; r < g->height; r++) {
+        for (int c = 0; c < g->width; c++) {
+          ptrdiff_t i = gridindex(g, r, c);
+          if (g->cells[i] > 9) {
+            more = true;
+            flash++;
+            g->cells[i] = -1;
+            FORSTENCIL(j, i, n8) {
+              if (g->cells[j] >= 0) {
+                g->cells[j]++;
+              }
+            }
+          }
+        }
+      }
+    }
+    truncall(g);
+  }
+  return flash;
+}
+
+// A worklist of the octopuses due to flash, as day 11 does now.
+static long by_worklist(Grid *g, int steps) {
+  Stencil n8 = gridn8(g);
+  ptrdiff_t *xs = xcalloc((size_t)g->width * g->height, sizeof(ptrdiff_t));
+  long flash = 0;
+  for (int s = 0; s < steps; s++) {
+    size_t len = 0;
+    for (int r = 0; r < g->height; r++) {
+      for (int c = 0; c < g->width; c++) {
+        signed char *x = gridat(g, r, c);
+        if (++*x > 9) {
+          xs[len++] = x - g->cells;
+        }
+      }
+    }
+    while (len) {
+      ptrdiff_t i = xs[--len];
+      flash++;
+      g->cells[i] = -1;
+      FORSTENCIL(j, i, n8) {
+        if (g->cells[j] >= 0 && ++g->cells[j] == 10) {
+          xs[len++] = j;
+        }
+      }
+    }
+    truncall(g);
+  }
+  free(xs);
+  return flash;
+}
+
+static long by_kernels(Grid *g, int steps, OctoIsa isa) {
+  Octopuses o = xmkoctopuses(g, isa);
+  long flash = 0;
+  for (int s = 0; s < steps; s++) {
+    flash += octostep(&o);
+  }
+  freeoctopuses(&o);
+  return flash;
+}
+
+// The bit-sliced board, sliced from (g) and written back to it.
+static long by_slice(Grid *g, int steps) {
+  OctoSlice s = xmkoctoslice(g);
+  long flash = 0;
+  for (int k = 0; k < steps; k++) {
+    flash += octoslicestep(&s);
+  }
+  octoslicegrid(&s, g);
+  freeoctoslice(&s);
+  return flash;
+}
+
+static int nthreads = 0;
+
+static long by_tiles(Grid *g, int steps) {
+  OctoTiles *t = xmkoctotiles(g, nthreads);
+  long flash = 0;
+  for (int s = 0; s < steps; s++) {
+    flash += octotilestep(t);
+  }
+  freeoctotiles(t);
+  return flash;
+}
+
+static long by_scalar(Grid *g, int steps) {
+  return by_kernels(g, steps, OCTO_SCALAR);
+}
+
+static long by_sse2(Grid *g, int steps) {
+  return by_kernels(g, steps, OCTO_SSE2);
+}
+
+static long by_avx2(Grid *g, int steps) {
+  return by_kernels(g, steps, OCTO_AVX2);
+}
+
+typedef struct {
+  char const *name;
+  long (*run)(Grid *, int);
+  OctoIsa isa; // the kernels it needs
+} Path;
+
+// FNV-1a over the cells.
+static unsigned long hashgrid(Grid const *g) {
+  unsigned long h = 14695981039346656037ul;
+  for (int r = 0; r < g->height; r++) {
+    for (int c = 0; c < g->width; c++) {
+      h = (h ^ (unsigned char)*gridat(g, r, c)) * 1099511628211ul;
+    }
+  }
+  return h;
+}
+
+int main(int argc, char *argv[]) {
+  int size = argc >= 2 ? atoi(argv[1]) : 1000;
+  int steps = argc >= 3 ? atoi(argv[2]) : 100;
+  int repeats = argc >= 4 ? atoi(argv[3]) : 3;
+  nthreads = argc >= 5 ? atoi(argv[4]) : 0;
+  if (size < 1 || steps < 0 || repeats < 1) {
+    fprintf(stderr, "Usage: %s [size] [steps] [repeats] [threads]\n",
+            argv[0]);
+    return 1;
+  }
+
+  Grid start = xmkgrid(size, size, 1, WALL);
+  srand(2021);
+  for (int r = 0; r < size; r++) {
+    for (int c = 0; c < size; c++) {
+      *gridat(&start, r, c) = rand() % 10;
+    }
+  }
+  Grid g = xmkgrid(size, size, 1, WALL);
+
+  Path const paths[] = {
+      {"rescan", by_rescan, OCTO_SCALAR},
+      {"worklist", by_worklist, OCTO_SCALAR},
+      {"scalar", by_scalar, OCTO_SCALAR},
+      {"sse2", by_sse2, OCTO_SSE2},
+      {"avx2", by_avx2, OCTO_AVX2},
+      {"tiles", by_tiles, OCTO_SCALAR},
+      {"slice", by_slice, OCTO_SCALAR},
+  };
+
+  printf("%d by %d, %d steps, best of %d\n", size, size, steps, repeats);
+  for (size_t k = 0; k < sizeof(paths) / sizeof(paths[0]); k++) {
+    if (!octoisa(paths[k].isa)) {
+      printf("%-10s (not supported)\n", paths[k].name);
+      continue;
+    }
+    double best = 1e30;
+    long flash = 0;
+    for (int r = 0; r < repeats; r++) {
+      memcpy(g.cells + gridlo(&g), start.cells + gridlo(&start),
+             gridsize(&g));
+      double t0 = now();
+      flash = paths[k].run(&g, steps);
+      double t = now() - t0;
+      best = t < best ? t : best;
+    }
+    printf("%-10s %9.3f ms/step  (flashes %ld, board %016lx)\n",
+           paths[k].name, best / (steps ? steps : 1) * 1e3, flash,
+           hashgrid(&g));
+  }
+
+  freegrid(start);
+  freegrid(g);
+  return 0;
+}
@@ -0,0 +1,136 @@
+// parsebench.c -- compare integer parsing paths on a block of numbers.
+//
+// Usage: ./parsebench.[dbg|rel] [input file] [repeats]
+//
+// Without an input file, a few million random depth-like numbers (one per
+// line) are generated. Each path parses the whole buffer; the checksum must
+// agree across paths.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lib/input.h"
+#include "lib/parseint.h"
+#include "lib/xalloc.h"
+
+#define NGEN 4000000
+#define BATCH 4096
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// What the solvers did originally: fscanf() on a stream.
+static long by_scanf(char *buf, size_t len) {
+  FILE *f = fmemopen(buf, len, "r");
+  long sum = 0, x;
+  while (fscanf(f, "%ld", &x) == 1) {
+    sum += x;
+  }
+  fclose(f);
+  return sum;
+}
+
+// getline() plus atoi(), as in day 1.
+static long by_getline(char *buf, size_t len) {
+  FILE *f = fmemopen(buf, len, "r");
+  char *line = NULL;
+  size_t cap = 0;
+  long sum = 0;
+  while (getline(&line, &cap, f) != -1) {
+    sum += atoi(line);
+  }
+  free(line);
+  fclose(f);
+  return sum;
+}
+
+// Line views and svtol().
+static long by_svtol(char *buf, size_t len) {
+  Input in = {.buf = buf, .len = len};
+  StrView line;
+  long sum = 0;
+  while (nextline(&in, &line)) {
+    sum += svtol(line, 10, NULL);
+  }
+  return sum;
+}
+
+static long by_block(char *buf, size_t len,
+                     size_t (*parse)(char const **, char const *, long *,
+                                     size_t)) {
+  static long xs[BATCH];
+  char const *p = buf, *end = buf + len;
+  long sum = 0;
+  size_t n;
+  while ((n = parse(&p, end, xs, BATCH))) {
+    for (size_t i = 0; i < n; i++) {
+      sum += xs[i];
+    }
+  }
+  return sum;
+}
+
+static long by_swar(char *buf, size_t len) {
+  return by_block(buf, len, parselongs_swar);
+}
+
+static long by_simd(char *buf, size_t len) {
+  return by_block(buf, len, parselongs);
+}
+
+typedef struct {
+  char const *name;
+  long (*run)(char *, size_t);
+} Path;
+
+int main(int argc, char *argv[]) {
+  int repeats = argc >= 3 ? atoi(argv[2]) : 3;
+  char *buf;
+  size_t len;
+  Input *in = NULL;
+
+  if (argc >= 2) {
+    in = xopeninput(argv[1]);
+    buf = in->buf;
+    len = in->len;
+  } else {
+    buf = xmalloc((size_t)NGEN * 8);
+    len = 0;
+    srand(2021);
+    for (int i = 0; i < NGEN; i++) {
+      len += sprintf(buf + len, "%d\n", rand() % 1000000);
+    }
+  }
+
+  Path const paths[] = {
+      {"scanf", by_scanf}, {"getline+atoi", by_getline},
+      {"svtol", by_svtol}, {"swar", by_swar},
+      {"simd", by_simd},
+  };
+
+  printf("%zu bytes, best of %d\n", len, repeats);
+  for (size_t k = 0; k < sizeof(paths) / sizeof(paths[0]); k++) {
+    double best = 1e30;
+    long sum = 0;
+    for (int r = 0; r < repeats; r++) {
+      double t0 = now();
+      sum = paths[k].run(buf, len);
+      double t = now() - t0;
+      best = t < best ? t : best;
+    }
+    printf("%-14s %8.1f MB/s  (checksum %ld)\n", paths[k].name,
+           len / best / 1e6, sum);
+  }
+
+  if (in) {
+    closeinput(in);
+  } else {
+    free(buf);
+  }
+  return 0;
+}